@@ -0,0 +1,178 @@
+/*
+ * Calendar grid: the day of month of each cell of a grid of whole weeks,
+ * either this week and the next or every week of this month, with Sunday
+ * or Monday in the first column and the ISO 8601 week of each row.
+ *
+ * Dates are day numbers, days since 1970-01-01 in local time. They turn
+ * into years, months and days through the tables below rather than a
+ * chain of month and leap year branches. A grid is built once and
+ * calendar_set_today() moves it on: within a week only today moves, into
+ * the second of two weeks the rows shift and one new week is filled, and
+ * the month view is only rebuilt when the month changes.
+ */
+#pragma once
+
+#define CALENDAR_MAX_WEEKS 6
+
+typedef enum {
+    CALENDAR_TWO_WEEKS,                 // this week and the next
+    CALENDAR_MONTH,                     // the 4 to 6 weeks this month touches
+} CalendarView;
+
+typedef struct {
+    CalendarView view;
+    uint8_t week_start;                 // column 0: 0 Sunday, 1 Monday
+    uint8_t weeks;                      // rows in use, 0 until built
+    int32_t first_day;                  // day number of cell 0
+    int32_t today;
+    int32_t month_begin;                // the month view's month, as day
+    int32_t month_end;                  // numbers from its 1st to the next 1st
+    uint8_t mday[CALENDAR_MAX_WEEKS * 7];
+    uint8_t iso_week[CALENDAR_MAX_WEEKS];   // of each row's Monday
+} CalendarGrid;
+
+// Days before each month, in common and leap years
+static const uint16_t calendar_month_start[2][13] = {
+    { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365 },
+    { 0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335, 366 },
+};
+
+static inline int calendar_is_leap(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+// Day number of January 1st; 477 leap days fall before 1970
+static inline int32_t calendar_year_start(int year) {
+    int y = year - 1;
+
+    return (int32_t)(year - 1970) * 365 + y / 4 - y / 100 + y / 400 - 477;
+}
+
+// Day number of a local date, from 1970 on
+static inline int32_t calendar_day_number(const struct tm *t) {
+    return calendar_year_start(t->tm_year + 1900) + t->tm_yday;
+}
+
+// 0 for Sunday, as tm_wday; 1970-01-01 was a Thursday
+static inline int calendar_weekday(int32_t day) {
+    return (day + 4) % 7;
+}
+
+// Year, month (0-11) and day of month of a day number from 1970 on
+static void calendar_civil(int32_t day, int *year, int *month, int *mday) {
+    // 146097 days in 400 years, off by at most a year either way
+    int y = 1970 + day * 400 / 146097;
+    int leap, yday, m;
+
+    if (calendar_year_start(y) > day) {
+        y--;
+    }
+    else if (calendar_year_start(y + 1) <= day) {
+        y++;
+    }
+    leap = calendar_is_leap(y);
+    yday = day - calendar_year_start(y);
+    // No month is over 31 days, so yday / 31 is this month or the one before
+    m = yday / 31;
+    if (yday >= calendar_month_start[leap][m + 1]) {
+        m++;
+    }
+    *year = y;
+    *month = m;
+    *mday = yday - calendar_month_start[leap][m] + 1;
+}
+
+static inline int calendar_month_length(int year, int month) {
+    int leap = calendar_is_leap(year);
+
+    return calendar_month_start[leap][month + 1] - calendar_month_start[leap][month];
+}
+
+// ISO 8601 week of a day: its Monday to Sunday week belongs to the year
+// its Thursday is in
+static uint8_t calendar_iso_week(int32_t day) {
+    int32_t thursday = day - (day + 3) % 7 + 3;
+    int year, month, mday;
+
+    calendar_civil(thursday, &year, &month, &mday);
+    return (uint8_t)((thursday - calendar_year_start(year)) / 7 + 1);
+}
+
+// Fill the rows from row on with the days that follow each other from there
+static void calendar_fill(CalendarGrid *grid, int row) {
+    int32_t day = grid->first_day + row * 7;
+    int year, month, mday, length;
+
+    calendar_civil(day, &year, &month, &mday);
+    length = calendar_month_length(year, month);
+    for (int i = row * 7; i < grid->weeks * 7; i++) {
+        grid->mday[i] = mday;
+        if (++mday > length) {
+            mday = 1;
+            if (++month == 12) {
+                month = 0;
+                year++;
+            }
+            length = calendar_month_length(year, month);
+        }
+    }
+    // Each row's Monday is its first or second cell. Weeks count up by
+    // one a row until the last of the year, 52 or 53.
+    for (int r = row; r < grid->weeks; r++, day += 7) {
+        uint8_t week = r ? grid->iso_week[r - 1] + 1 : 0;
+
+        grid->iso_week[r] = week && week <= 52 ? week : calendar_iso_week(day + !grid->week_start);
+    }
+}
+
+static void calendar_build(CalendarGrid *grid, CalendarView view, uint8_t week_start, int32_t today) {
+    grid->view = view;
+    grid->week_start = week_start;
+    grid->today = today;
+    if (view == CALENDAR_TWO_WEEKS) {
+        grid->first_day = today - (calendar_weekday(today) + 7 - week_start) % 7;
+        grid->weeks = 2;
+        grid->month_begin = grid->month_end = 0;
+    }
+    else {
+        int year, month, mday;
+
+        calendar_civil(today, &year, &month, &mday);
+        grid->month_begin = today - (mday - 1);
+        grid->month_end = grid->month_begin + calendar_month_length(year, month);
+        grid->first_day = grid->month_begin -
+            (calendar_weekday(grid->month_begin) + 7 - week_start) % 7;
+        grid->weeks = (grid->month_end - grid->first_day + 6) / 7;
+    }
+    calendar_fill(grid, 0);
+}
+
+// Move a built grid to today, usually a day on from the last
+static void calendar_set_today(CalendarGrid *grid, int32_t today) {
+    int32_t offset = today - grid->first_day;
+
+    if (grid->view == CALENDAR_MONTH) {
+        // The grid holds until the month changes
+        if (today < grid->month_begin || today >= grid->month_end) {
+            calendar_build(grid, grid->view, grid->week_start, today);
+            return;
+        }
+    }
+    else if (offset >= 7 && offset < 14) {
+        // Next week becomes this week and a new one follows
+        memmove(grid->mday, grid->mday + 7, 7);
+        grid->iso_week[0] = grid->iso_week[1];
+        grid->first_day += 7;
+        calendar_fill(grid, 1);
+    }
+    else if (offset < 0 || offset >= 7) {
+        calendar_build(grid, grid->view, grid->week_start, today);
+        return;
+    }
+    grid->today = today;
+}
+
+// Cell of today, its column is (cell % 7) and its row (cell / 7)
+static inline int calendar_today_cell(const CalendarGrid *grid) {
+    return grid->today - grid->first_day;
+}
@@ -0,0 +1,212 @@
+/*
+ * Phone side of calendar_face's event markers.
+ *
+ * Reads the events of an iCalendar (.ics) URL, set on the configuration
+ * page, counts them for each of the 14 days in the watch's calendar strip
+ * and sends the counts that changed since the last sync in one AppMessage:
+ *
+ *   EVENT_DAY     days since 1970 (local time) of the strip's first day
+ *   EVENT_DELTA   bytes, an (offset from EVENT_DAY, count) pair per changed day
+ *   EVENT_RESET   present when the watch should drop what it has first
+ *
+ * The watch sends EVENT_REQUEST when it has nothing cached, with the day
+ * its strip starts the week on in EVENT_WEEK_START (0 Sunday, 1 Monday).
+ * The answer is always a full sync, and the week start is kept for later.
+ *
+ * Both sides move their counts to the new EVENT_DAY before applying the
+ * pairs, so days that stay in view and did not change cost nothing. What
+ * the watch acked is kept in localStorage to diff the next sync against.
+ * Syncs run when the app starts and every few hours after, and send
+ * nothing when nothing changed, so the watch radio wakes a few times a
+ * day at most however many events there are.
+ */
+
+var WINDOW_DAYS = 14;
+var MAX_COUNT = 3;              // the watch draws at most this many dots
+var SYNC_INTERVAL_MS = 6 * 60 * 60 * 1000;
+var RETRY_MS = 30 * 1000;
+var MAX_RETRIES = 3;
+var DAY_MS = 24 * 60 * 60 * 1000;
+
+var CONFIG_PAGE =
+  '<!DOCTYPE html><html><head><meta name="viewport" content="width=device-width">' +
+  '<title>Calendar Face</title></head><body>' +
+  '<p>Calendar URL (.ics)</p>' +
+  '<input id="url" type="url" style="width:100%" value="$URL">' +
+  '<p><button onclick="location.href=\'pebblejs://close#\' + ' +
+  'encodeURIComponent(document.getElementById(\'url\').value)">Save</button></p>' +
+  '</body></html>';
+
+// The sync in flight, syncs asked for meanwhile fold into it
+var pending = null;
+
+// Days since 1970 of a date's local day, as the watch counts them
+function localDay(date) {
+  return Math.floor((date.getTime() - date.getTimezoneOffset() * 60000) / DAY_MS);
+}
+
+// The strip starts on the first day of this week, as the watch said it
+// counts weeks
+function windowStart(now) {
+  var weekStart = +(localStorage.getItem('weekStart') || 0);
+
+  return localDay(now) - (now.getDay() + 7 - weekStart) % 7;
+}
+
+/*
+ * The local day each VEVENT starts on. All-day and floating times are
+ * taken as local, TZID times too; recurrence rules are not expanded.
+ */
+function eventDays(ics) {
+  var lines = ics.replace(/\r?\n[ \t]/g, '').split(/\r?\n/);
+  var inEvent = false;
+  var days = [];
+
+  lines.forEach(function(line) {
+    var m;
+
+    if (line === 'BEGIN:VEVENT') {
+      inEvent = true;
+    } else if (line === 'END:VEVENT') {
+      inEvent = false;
+    } else if (inEvent &&
+               (m = /^DTSTART[^:]*:(\d{4})(\d\d)(\d\d)(?:T(\d\d)(\d\d)(\d\d)(Z?))?/.exec(line))) {
+      var f = m.slice(1, 7).map(function(v) { return +(v || 0); });
+      var date = m[7] ?
+        new Date(Date.UTC(f[0], f[1] - 1, f[2], f[3], f[4], f[5])) :
+        new Date(f[0], f[1] - 1, f[2], f[3], f[4], f[5]);
+      days.push(localDay(date));
+    }
+  });
+  return days;
+}
+
+function countEvents(days, first) {
+  var counts = [];
+
+  for (var i = 0; i < WINDOW_DAYS; i++) {
+    counts.push(0);
+  }
+  days.forEach(function(day) {
+    var i = day - first;
+    if (i >= 0 && i < WINDOW_DAYS && counts[i] < MAX_COUNT) {
+      counts[i]++;
+    }
+  });
+  return counts;
+}
+
+// The watch's counts once it moved them to start at first
+function rebase(state, first) {
+  var counts = [];
+
+  for (var i = 0; i < WINDOW_DAYS; i++) {
+    var old = first + i - state.first;
+    counts.push(old >= 0 && old < WINDOW_DAYS ? state.counts[old] : 0);
+  }
+  return counts;
+}
+
+// The message taking the watch from prev (null if unknown) to next, or
+// null if it already shows next
+function encode(prev, next) {
+  var base = prev ? rebase(prev, next.first) : null;
+  var delta = [];
+
+  next.counts.forEach(function(count, i) {
+    if (base ? count !== base[i] : count) {
+      delta.push(i, count);
+    }
+  });
+  if (base && !delta.length) {
+    return null;
+  }
+  var message = { EVENT_DAY: next.first, EVENT_DELTA: delta };
+  if (!base) {
+    message.EVENT_RESET = 1;
+  }
+  return message;
+}
+
+function loadSent() {
+  try {
+    return JSON.parse(localStorage.getItem('sent'));
+  } catch (e) {
+    return null;
+  }
+}
+
+function send(message, next, attempt) {
+  Pebble.sendAppMessage(message, function() {
+    localStorage.setItem('sent', JSON.stringify(next));
+  }, function() {
+    // Unacked, the watch may or may not have it: retry the same message,
+    // then give up and send everything next time
+    if (attempt < MAX_RETRIES) {
+      setTimeout(function() { send(message, next, attempt + 1); }, RETRY_MS * (attempt + 1));
+    } else {
+      localStorage.removeItem('sent');
+    }
+  });
+}
+
+function sync(reset) {
+  var url = localStorage.getItem('icsUrl');
+
+  if (pending) {
+    pending.reset = pending.reset || reset;
+    return;
+  }
+  if (!url) {
+    return;
+  }
+  pending = { reset: reset };
+  var req = new XMLHttpRequest();
+  req.onload = function() {
+    var reset = pending.reset;
+
+    pending = null;
+    if (req.status !== 200) {
+      return;     // the watch keeps what it has until the next sync
+    }
+    var now = new Date();
+    var first = windowStart(now);
+    var next = { first: first, counts: countEvents(eventDays(req.responseText), first) };
+    var message = encode(reset ? null : loadSent(), next);
+    if (message) {
+      send(message, next, 0);
+    }
+  };
+  req.onerror = function() {
+    pending = null;
+  };
+  req.open('GET', url);
+  req.send();
+}
+
+Pebble.addEventListener('ready', function() {
+  sync(false);
+  setInterval(function() { sync(false); }, SYNC_INTERVAL_MS);
+});
+
+// The watch asks when it has nothing cached
+Pebble.addEventListener('appmessage', function(e) {
+  if (e.payload.EVENT_REQUEST) {
+    if (e.payload.EVENT_WEEK_START !== undefined) {
+      localStorage.setItem('weekStart', e.payload.EVENT_WEEK_START);
+    }
+    sync(true);
+  }
+});
+
+Pebble.addEventListener('showConfiguration', function() {
+  var url = (localStorage.getItem('icsUrl') || '').replace(/"/g, '&quot;');
+  Pebble.openURL('data:text/html,' + encodeURIComponent(CONFIG_PAGE.replace('$URL', function() { return url; })));
+});
+
+Pebble.addEventListener('webviewclosed', function(e) {
+  if (e.response) {
+    localStorage.setItem('icsUrl', decodeURIComponent(e.response));
+    sync(true);
+  }
+});
@@ -0,0 +1,33 @@
+/*
+ * Screen layout, chosen at compile time for the platform being built.
+ */
+#pragma once
+
+#if defined(PBL_RECT)
+// aplite and basalt, 144x168
+#define LAYOUT_WIDTH            144
+#define LAYOUT_HEIGHT           168
+#define CALENDAR_LAYER_HEIGHT   48
+#ifdef CONFIG_WEEK_NUMBERS
+// ISO week numbers in a column left of the days
+#define CALENDAR_WEEK_WIDTH     16
+#define CALENDAR_CELL_WIDTH     18
+#else
+#define CALENDAR_WEEK_WIDTH     0
+#define CALENDAR_CELL_WIDTH     20
+#endif
+#define CALENDAR_CELL_HEIGHT    15
+#define CALENDAR_CELL_GAP       2
+#define CALENDAR_CELL_X(column) (CALENDAR_CELL_GAP + CALENDAR_WEEK_WIDTH + CALENDAR_CELL_WIDTH * (column))
+#define LAYOUT_TIME             GRect(0, 28, LAYOUT_WIDTH, 70)
+#define LAYOUT_DATE             GRect(8, LAYOUT_HEIGHT - CALENDAR_LAYER_HEIGHT - 25, LAYOUT_WIDTH * 2 / 3, 25)
+#define LAYOUT_DURATION         GRect(LAYOUT_WIDTH * 2 / 3, LAYOUT_HEIGHT - CALENDAR_LAYER_HEIGHT - 25, \
+                                      LAYOUT_WIDTH / 3, 25)
+#define LAYOUT_BATTERY          GRect(0, 0, LAYOUT_WIDTH - 28, 20)
+#define LAYOUT_BLUETOOTH        GRect(LAYOUT_WIDTH - 24, 4, 14, 12)
+#define LAYOUT_CALENDAR         GRect(0, LAYOUT_HEIGHT - CALENDAR_LAYER_HEIGHT, LAYOUT_WIDTH, CALENDAR_LAYER_HEIGHT)
+// Battery dot i of 10, evenly spread across LAYOUT_BATTERY
+#define BATTERY_DOT(i)          GPoint(((i) + 1) * (LAYOUT_WIDTH - 28) / 11, 20 / 2)
+#else
+#error "calendar_face has no layout for round screens"
+#endif
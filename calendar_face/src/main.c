@@ -1,7 +1,44 @@
 #include <pebble.h>
 
+/*#define CONFIG_PROFILE*/
+/*#define CONFIG_WEEK_START_MONDAY*/
+/*#define CONFIG_WEEK_NUMBERS*/
+
+#include "layout.h"
+#include "calendar.h"
+#include "profile.h"
+#include "frame.h"
+#include "tick.h"
+#include "bluetooth.h"
+#include "text.h"
+#include "raw.h"
+
+// Timed with CONFIG_PROFILE, a triple tap logs them
+PROFILE_RING(calendar_layer_update);
+PROFILE_RING(first_frame);
+PROFILE_RING(startup);
+
 static Window *window;
 
+// The time is shown first, everything else is built once it is drawn
+static AppTimer *startup_timer;     // pending until the rest is built
+static bool startup_done;           // the rest is built
+static void main_window_load_deferred(void *data);
+
+// Resource cache. Bitmaps and fonts are loaded on first use and stay cached
+// after they are released, until the heap runs low.
+#define RESOURCE_CACHE_SIZE     6
+#define RESOURCE_HEAP_RESERVE   4096    // bytes of heap to keep free
+typedef struct {
+    uint32_t id;        // 0 for an empty slot
+    uint8_t users;
+    uint32_t last_use;
+    GBitmap *bitmap;
+    GFont font;
+} CachedResource;
+static CachedResource resource_cache[RESOURCE_CACHE_SIZE];
+static uint32_t resource_clock = 0;
+
 // Date and time
 #define TIME_FONT RESOURCE_ID_FONT_DIGITAL_SEVEN_66
 #define DATE_FONT RESOURCE_ID_FONT_DIGITAL_SEVEN_16
@@ -11,126 +48,301 @@ static Window *window;
 static GFont time_font;
 static GFont date_font;
 static TextLayer *date_layer;
-static TextLayer *time_layer;
+static Layer *time_layer;           // drawn by hand, to know when it is out
+static char time_text[] = "00:00";
 
 // Battery and bluetooth
-#define BATTERY_DURATION_FORMAT "%dD%02dH"
-#define BATTERY_CHARGING_FORMAT "%dH%02dM"
+#define BATTERY_DURATION_FORMAT "%uD%02uH"
+#define BATTERY_CHARGING_FORMAT "%uH%02uM"
+#define BATTERY_REMAINING_FORMAT "R%uD%02uH"
 static Layer *battery_layer;
 
-static GPoint battery_dot_points[10];
+static const GPoint battery_dot_points[10] = {
+    BATTERY_DOT(0), BATTERY_DOT(1), BATTERY_DOT(2), BATTERY_DOT(3), BATTERY_DOT(4),
+    BATTERY_DOT(5), BATTERY_DOT(6), BATTERY_DOT(7), BATTERY_DOT(8), BATTERY_DOT(9),
+};
+static uint8_t battery_dots;        // filled dots the layer shows
 static Layer *bluetooth_layer;
 static TextLayer *battery_duration_layer;
-static GBitmap *icon_bluetooth_linked;
-static GBitmap *icon_bluetooth_unlinked;
+static GBitmap *icon_bluetooth;     // only the shown icon is held
+static uint32_t icon_bluetooth_id = 0;
 static uint8_t battery_level;
 static bool battery_plugged;
-static bool bluetoothConnected = false;
 
-// persistent storage
-#define LAST_CHARGE_PKEY 0xd3943c7a
+// Discharge estimate: a least squares line through the last few battery
+// samples, kept as running sums so a sample is O(1) and needs no floats
+#define DISCHARGE_SAMPLES 12
+typedef struct {
+    int32_t base;                           // time of the first sample, unit: second
+    uint16_t minute[DISCHARGE_SAMPLES];     // since base
+    uint8_t percent[DISCHARGE_SAMPLES];
+    uint8_t count;
+    uint8_t head;                           // next slot, the oldest once full
+    int32_t sum_t;
+    int32_t sum_c;
+    int64_t sum_tt;
+    int64_t sum_tc;
+} DischargeEstimator;
+static DischargeEstimator discharge;
+
+// Event markers from the phone companion, src/js/app.js: how many events
+// each day of the calendar strip has. A sync is one AppMessage carrying the
+// first day and the (offset, count) pairs that changed since the last one.
+#define KEY_EVENT_DAY       0           // see appKeys in appinfo.json
+#define KEY_EVENT_DELTA     1
+#define KEY_EVENT_RESET     2
+#define KEY_EVENT_REQUEST   3
+#define KEY_EVENT_WEEK_START 4          // with a request, CALENDAR_WEEK_START
+#define EVENT_DAYS          14
+#define EVENT_MAX           3           // dots drawn under a day
+#define EVENT_INBOX_SIZE    64
+#define EVENT_OUTBOX_SIZE   32
+#define EVENT_RETRY_MS      30000       // then twice that, and so on
+#define EVENT_RETRIES       4
+typedef struct __attribute__((__packed__)) {
+    int32_t day;                        // days since 1970 of count[0], 0 if none yet
+    uint8_t count[EVENT_DAYS];
+} EventMarkers;
+static EventMarkers events;
+static AppTimer *events_retry_timer;
+static uint8_t events_retries;
+
+// persistent storage, one packed struct written a while after it last changed
+#define STORAGE_PKEY     0xd3943c7b
+#define STORAGE_VERSION  3
+#define STORAGE_FLUSH_MS 30000
+#define LAST_CHARGE_PKEY 0xd3943c7a     // before STORAGE_PKEY, migrated on load
+typedef struct __attribute__((__packed__)) {
+    uint8_t version;
+    int32_t last_charge;                // since version 1
+    DischargeEstimator discharge;       // since version 2
+    EventMarkers events;                // since version 3
+} Storage;
+static AppTimer *storage_timer;
+static bool storage_unsaved;    // discharge samples only written on exit
 static time_t last_charge = 0;  // unit: second
 static int battery_duration = 0;    // unit: minute
 
+// Tick elements, see tick.h
+enum { TICK_TIME, TICK_DATE, TICK_BATTERY };
+
+// What a frame pass brings up to date, see frame.h and frame_apply()
+enum {
+    FRAME_TIME = 1 << 0,
+    FRAME_DATE = 1 << 1,                // date text and the calendar's today
+    FRAME_CALENDAR = 1 << 2,            // event markers
+    FRAME_BATTERY = 1 << 3,             // battery dots
+    FRAME_DURATION = 1 << 4,            // battery duration text
+    FRAME_BLUETOOTH = 1 << 5,
+};
+static struct tm frame_time;            // of the last tick
+
 // Calendar
 #define CALENDAR_FONT FONT_KEY_GOTHIC_14
-#define CALENDAR_LAYER_HEIGHT  48
-#define CALENDAR_CELL_WIDTH    20
-#define CALENDAR_CELL_HEIGHT   15
-#define CALENDAR_CELL_GAP       2
 static Layer *calendar_layer;
+static GFont calendar_font;
 static const char *strDaysOfWeek[] = {
     "Su", "Mo", "Tu", "We", "Th", "Fr", "Sa"
 };
+// "%2d" of days of the month and ISO weeks
+static const char numberText[54][3] = {
+    "", " 1", " 2", " 3", " 4", " 5", " 6", " 7", " 8", " 9",
+    "10", "11", "12", "13", "14", "15", "16", "17", "18", "19",
+    "20", "21", "22", "23", "24", "25", "26", "27", "28", "29",
+    "30", "31", "32", "33", "34", "35", "36", "37", "38", "39",
+    "40", "41", "42", "43", "44", "45", "46", "47", "48", "49",
+    "50", "51", "52", "53"
+};
+
+#ifdef CONFIG_WEEK_START_MONDAY
+#define CALENDAR_WEEK_START 1
+#else
+#define CALENDAR_WEEK_START 0
+#endif
 
-// How many days are/were in the month
-int days_in_month(int mon, int year) {
-    mon++; // dec = 0|12, lazily optimized
-    switch (mon) {
-        // April, June, September and November have 30 Days
-        case 4:
-        case 6:
-        case 9:
-        case 11:
-            return 30;
-        // Deal with Feburary & Leap years
-        case 2:
-            if (year % 400 == 0) {
-                return 29;
-            } else if (year % 100 == 0) {
-                return 28;
-            } else if (year % 4 == 0) {
-                return 29;
-            } else {
-                return 28;
+// This week and the next. They only change at DAY_UNIT, see src/calendar.h.
+static CalendarGrid calendar;
+static GBitmap *calendar_bitmap;
+static bool calendar_cached = false;
+
+static void resource_cache_evict(CachedResource *entry) {
+    if (entry->bitmap) {
+        gbitmap_destroy(entry->bitmap);
+    }
+    if (entry->font) {
+        fonts_unload_custom_font(entry->font);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+// Drop released entries, least recently used first, while the heap is low
+static void resource_cache_trim(void) {
+    while (heap_bytes_free() < RESOURCE_HEAP_RESERVE) {
+        CachedResource *lru = NULL;
+
+        for (int i = 0; i < RESOURCE_CACHE_SIZE; i++) {
+            CachedResource *entry = &resource_cache[i];
+            if (entry->id && !entry->users &&
+                (!lru || entry->last_use < lru->last_use)) {
+                lru = entry;
             }
-        // Most months have 31 days
-        default:
-            return 31;
+        }
+        if (!lru) {
+            return;
+        }
+        resource_cache_evict(lru);
     }
 }
 
-void get_calendar(int calendar[14], struct tm *current_time)
-{
-    int mon = current_time->tm_mon;
-    int year = current_time->tm_year + 1900;
-    int daysThisMonth = days_in_month(mon, year);
-    int i, cellNum = 0;   // address for current day table cell: 0-20
-    int daysVisPrevMonth = 0;
-    int daysVisNextMonth = 0;
-    int daysPriorToToday = current_time->tm_wday; // just instantiating, not final value
-    int daysAfterToday   = (6 - current_time->tm_wday) % 7 + 7; // just instantiating, not final value
-
-    if (daysPriorToToday >= current_time->tm_mday) {
-        // We're showing more days before today than exist this month
-        int daysInPrevMonth = days_in_month(mon - 1,year); // year only matters for February, which will be the same 'from' March
-
-        // Number of days we'll show from the previous month
-        daysVisPrevMonth = daysPriorToToday - current_time->tm_mday + 1;
-
-        for (i = 0; i < daysVisPrevMonth; i++, cellNum++) {
-            calendar[cellNum] = daysInPrevMonth + i - daysVisPrevMonth + 1;
+static CachedResource *resource_cache_acquire(uint32_t id, bool font) {
+    CachedResource *slot = NULL;
+
+    for (int i = 0; i < RESOURCE_CACHE_SIZE; i++) {
+        if (resource_cache[i].id == id) {
+            slot = &resource_cache[i];
+            break;
         }
     }
 
-    // optimization: instantiate i to a hot mess, since the first day we show this month may not be the 1st of the month
-    int firstDayShownThisMonth = daysVisPrevMonth + current_time->tm_mday - daysPriorToToday;
-    for (i = firstDayShownThisMonth; i < current_time->tm_mday; i++, cellNum++) {
-        calendar[cellNum] = i;
+    if (!slot) {
+        resource_cache_trim();
+        for (int i = 0; i < RESOURCE_CACHE_SIZE; i++) {
+            CachedResource *entry = &resource_cache[i];
+            if (!entry->id) {
+                slot = entry;
+                break;
+            }
+            if (!entry->users && (!slot || entry->last_use < slot->last_use)) {
+                slot = entry;
+            }
+        }
+        if (!slot) {
+            APP_LOG(APP_LOG_LEVEL_ERROR, "resource cache full, can't load %d", (int)id);
+            return NULL;
+        }
+        resource_cache_evict(slot);
+        if (font) {
+            slot->font = fonts_load_custom_font(resource_get_handle(id));
+        }
+        else {
+            slot->bitmap = gbitmap_create_with_resource(id);
+        }
+        if (!slot->bitmap && !slot->font) {
+            return NULL;
+        }
+        slot->id = id;
     }
 
-    // the current day... we'll style this special
-    calendar[cellNum] = current_time->tm_mday;
-    cellNum++;
+    slot->users++;
+    slot->last_use = ++resource_clock;
+    return slot;
+}
 
-    if (current_time->tm_mday + daysAfterToday > daysThisMonth) {
-        daysVisNextMonth = current_time->tm_mday + daysAfterToday - daysThisMonth;
+GBitmap *resource_cache_bitmap(uint32_t id) {
+    CachedResource *entry = resource_cache_acquire(id, false);
+    return entry ? entry->bitmap : NULL;
+}
+
+GFont resource_cache_font(uint32_t id) {
+    CachedResource *entry = resource_cache_acquire(id, true);
+    return entry ? entry->font : NULL;
+}
+
+// Hand back a resource that is no longer shown, it stays cached if there's room
+void resource_cache_release(uint32_t id) {
+    for (int i = 0; i < RESOURCE_CACHE_SIZE; i++) {
+        if (resource_cache[i].id == id && resource_cache[i].users) {
+            resource_cache[i].users--;
+        }
+    }
+    resource_cache_trim();
+}
+
+// Hand back a resource and free it right away when nothing else uses it.
+// For the Bluetooth icons: only one is ever shown and they swap rarely, so
+// keeping the other one cached is a wasted bitmap on aplite's heap.
+void resource_cache_discard(uint32_t id) {
+    for (int i = 0; i < RESOURCE_CACHE_SIZE; i++) {
+        CachedResource *entry = &resource_cache[i];
+        if (entry->id == id && entry->users && !--entry->users) {
+            resource_cache_evict(entry);
+        }
+    }
+}
+
+void resource_cache_flush(void) {
+    for (int i = 0; i < RESOURCE_CACHE_SIZE; i++) {
+        resource_cache_evict(&resource_cache[i]);
+    }
+}
+
+void update_calendar(struct tm *current_time) {
+    int32_t today = calendar_day_number(current_time);
+
+    if (calendar.weeks) {
+        calendar_set_today(&calendar, today);
     }
+    else {
+        calendar_build(&calendar, CALENDAR_TWO_WEEKS, CALENDAR_WEEK_START, today);
+    }
+    calendar_cached = false;
+}
 
-    // add the days after today until the end of the month/next week, to our array...
-    int daysLeftThisMonth = daysAfterToday - daysVisNextMonth;
-    for (i = 0; i < daysLeftThisMonth; i++, cellNum++) {
-        calendar[cellNum] = i + current_time->tm_mday + 1;
+// Copy the freshly drawn strip out of the frame buffer so later frames can blit it
+static void cache_calendar(Layer *me, GContext *ctx) {
+    GRect frame = layer_get_frame(me);
+    GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+    if (!fb) {
+        return;
+    }
+    if (!calendar_bitmap) {
+        calendar_bitmap = gbitmap_create_blank(frame.size, gbitmap_get_format(fb));
     }
+    if (calendar_bitmap) {
+        uint8_t *src = gbitmap_get_data(fb);
+        uint8_t *dst = gbitmap_get_data(calendar_bitmap);
+        uint16_t src_row = gbitmap_get_bytes_per_row(fb);
+        uint16_t dst_row = gbitmap_get_bytes_per_row(calendar_bitmap);
+
+        // The strip spans the whole width, so its rows start at the frame buffer's
+        for (int y = 0; y < frame.size.h; y++) {
+            memcpy(dst + y * dst_row, src + (frame.origin.y + y) * src_row,
+                   dst_row < src_row ? dst_row : src_row);
+        }
+        RAW_PIXELS(frame.size.w * frame.size.h);
+        calendar_cached = true;
+    }
+    graphics_release_frame_buffer(ctx, fb);
+}
+
+// One dot per event, up to EVENT_MAX, centered along the bottom of the cell
+static void draw_event_dots(GContext *ctx, GRect cell, int32_t day) {
+    int32_t index = day - events.day;
+    int count = index >= 0 && index < EVENT_DAYS ? events.count[index] : 0;
+    int x = cell.origin.x + (cell.size.w - (count * 4 - 2)) / 2;
 
-    // add any days in the next month to our array...
-    for (i = 0; i < daysVisNextMonth; i++, cellNum++) {
-        calendar[cellNum] = i + 1;
+    for (int i = 0; i < count; i++) {
+        graphics_fill_rect(ctx, GRect(x + i * 4, cell.origin.y + cell.size.h - 2, 2, 2), 0, GCornerNone);
     }
 }
 
 void calendar_layer_update(Layer *me, GContext* ctx) {
-    time_t now = time(NULL);
-    struct tm *current_time = localtime(&now);
-    int calendar[14];
-    char calendar_text[] = "00.";
+    PROFILE_SCOPE(calendar_layer_update);
     GRect bounds = layer_get_bounds(me);
+    int today_column = calendar_today_cell(&calendar) % 7;
     GRect current_bounds = GRect(
-        bounds.origin.x + CALENDAR_CELL_GAP +
-        CALENDAR_CELL_WIDTH * current_time->tm_wday,
+        bounds.origin.x + CALENDAR_CELL_X(today_column),
         bounds.origin.y, CALENDAR_CELL_WIDTH, bounds.size.h
     );
 
+    // The strip only changes at DAY_UNIT, see update_calendar()
+    if (calendar_cached) {
+        graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+        graphics_draw_bitmap_in_rect(ctx, calendar_bitmap, bounds);
+        return;
+    }
+
     graphics_context_set_fill_color(ctx, GColorWhite);
     graphics_context_set_stroke_color(ctx, GColorWhite);
     graphics_fill_rect(ctx, bounds, 0, GCornerNone);
@@ -139,9 +351,8 @@ void calendar_layer_update(Layer *me, GContext* ctx) {
     graphics_context_set_stroke_color(ctx, GColorBlack);
     graphics_fill_rect(ctx, current_bounds, 0, GCornerNone);
 
-    get_calendar(calendar, current_time);
     for (int i = 0; i < 7; i++) {
-        if (i == current_time->tm_wday) {
+        if (i == today_column) {
             graphics_context_set_stroke_color(ctx, GColorWhite);
             graphics_context_set_fill_color(ctx, GColorWhite);
             graphics_context_set_text_color(ctx, GColorWhite);
@@ -152,71 +363,336 @@ void calendar_layer_update(Layer *me, GContext* ctx) {
             graphics_context_set_text_color(ctx, GColorBlack);
         }
 
-        graphics_draw_text(ctx, strDaysOfWeek[i],
-            fonts_get_system_font(FONT_KEY_GOTHIC_14),
-            GRect(bounds.origin.x + CALENDAR_CELL_GAP +
-                  CALENDAR_CELL_WIDTH * i, bounds.origin.y,
+        graphics_draw_text(ctx, strDaysOfWeek[(i + calendar.week_start) % 7], calendar_font,
+            GRect(bounds.origin.x + CALENDAR_CELL_X(i), bounds.origin.y,
                   CALENDAR_CELL_WIDTH, CALENDAR_CELL_HEIGHT),
             GTextOverflowModeWordWrap,
             GTextAlignmentCenter, NULL
         );
 
-        snprintf(calendar_text, sizeof(calendar_text), "%2d", calendar[i]);
-        graphics_draw_text(ctx, calendar_text,
-            fonts_get_system_font(FONT_KEY_GOTHIC_14),
-            GRect(bounds.origin.x + CALENDAR_CELL_GAP + CALENDAR_CELL_WIDTH * i,
-                  bounds.origin.y + CALENDAR_CELL_HEIGHT,
-                  CALENDAR_CELL_WIDTH, CALENDAR_CELL_HEIGHT),
-            GTextOverflowModeWordWrap,
-            GTextAlignmentCenter, NULL
-        );
+        for (int week = 0; week < calendar.weeks; week++) {
+            int index = week * 7 + i;
+            GRect cell = GRect(bounds.origin.x + CALENDAR_CELL_X(i),
+                               bounds.origin.y + CALENDAR_CELL_HEIGHT * (week + 1),
+                               CALENDAR_CELL_WIDTH, CALENDAR_CELL_HEIGHT);
+
+            graphics_draw_text(ctx, numberText[calendar.mday[index]], calendar_font, cell,
+                GTextOverflowModeWordWrap,
+                GTextAlignmentCenter, NULL
+            );
+            draw_event_dots(ctx, cell, calendar.first_day + index);
+        }
+    }
 
-        snprintf(calendar_text, sizeof(calendar_text), "%2d", calendar[i+7]);
-        graphics_draw_text(ctx, calendar_text,
-            fonts_get_system_font(FONT_KEY_GOTHIC_14),
-            GRect(bounds.origin.x + CALENDAR_CELL_GAP + CALENDAR_CELL_WIDTH * i,
-                  bounds.origin.y + CALENDAR_CELL_HEIGHT * 2,
-                  CALENDAR_CELL_WIDTH, CALENDAR_CELL_HEIGHT),
+#ifdef CONFIG_WEEK_NUMBERS
+    graphics_context_set_text_color(ctx, GColorBlack);
+    for (int week = 0; week < calendar.weeks; week++) {
+        graphics_draw_text(ctx, numberText[calendar.iso_week[week]], calendar_font,
+            GRect(bounds.origin.x + CALENDAR_CELL_GAP,
+                  bounds.origin.y + CALENDAR_CELL_HEIGHT * (week + 1),
+                  CALENDAR_WEEK_WIDTH, CALENDAR_CELL_HEIGHT),
             GTextOverflowModeWordWrap,
             GTextAlignmentCenter, NULL
         );
     }
+#endif
+
+    cache_calendar(me, ctx);
 }
 
 void draw_date(struct tm *t) {
-    static char date_text[] = "1990/10/14";
+    static char date_text[sizeof("1990/10/14")];
+    char text[sizeof(date_text)];
 
-    strftime(date_text, sizeof(date_text), DATE_FORMAT, t);
-    text_layer_set_text(date_layer, date_text);
+    strftime(text, sizeof(text), DATE_FORMAT, t);
+    set_text_if_changed(date_layer, date_text, sizeof(date_text), text);
 }
 
 void draw_time(struct tm *t) {
-    static char time_text[] = "00:00";
-
 	if (clock_is_24h_style()) {
 		strftime(time_text, sizeof(time_text), TIME_24H_FORMAT, t);
 	}
 	else {
 		strftime(time_text, sizeof(time_text), TIME_12H_FORMAT, t);
 	}
-    text_layer_set_text(time_layer, time_text);
+    layer_mark_dirty(time_layer);
+}
+
+void time_layer_update(Layer *me, GContext* ctx) {
+    graphics_context_set_text_color(ctx, GColorWhite);
+    graphics_draw_text(ctx, time_text, time_font, layer_get_bounds(me),
+        GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
+    PROFILE_STOP(first_frame);
+
+    // The first frame goes out when this returns, build the rest right after
+    if (!startup_done && !startup_timer) {
+        startup_timer = app_timer_register(0, main_window_load_deferred, NULL);
+    }
+}
+
+/*
+ * Discharge estimate
+ */
+void discharge_reset(DischargeEstimator *e) {
+    memset(e, 0, sizeof(*e));
+}
+
+void discharge_add(DischargeEstimator *e, time_t now, uint8_t percent) {
+    if (!e->count || now - e->base > UINT16_MAX * 60) {
+        discharge_reset(e);
+        e->base = (int32_t)now;
+    }
+    int32_t t = (int32_t)(now - e->base) / 60;
+
+    if (e->count == DISCHARGE_SAMPLES) {
+        int32_t old_t = e->minute[e->head];
+        int32_t old_c = e->percent[e->head];
+
+        e->sum_t -= old_t;
+        e->sum_c -= old_c;
+        e->sum_tt -= (int64_t)old_t * old_t;
+        e->sum_tc -= (int64_t)old_t * old_c;
+    }
+    else {
+        e->count++;
+    }
+
+    e->minute[e->head] = (uint16_t)t;
+    e->percent[e->head] = percent;
+    e->head = (e->head + 1) % DISCHARGE_SAMPLES;
+    e->sum_t += t;
+    e->sum_c += percent;
+    e->sum_tt += (int64_t)t * t;
+    e->sum_tc += (int64_t)t * percent;
+}
+
+// When the fitted line reaches 0%, false until there is a falling trend
+bool discharge_empty_at(const DischargeEstimator *e, time_t *empty) {
+    int64_t n = e->count;
+    int64_t num = n * e->sum_tc - (int64_t)e->sum_t * e->sum_c;
+    int64_t den = n * e->sum_tt - (int64_t)e->sum_t * e->sum_t;
+
+    if (n < 2 || den <= 0 || num >= 0) {
+        return false;
+    }
+
+    // Where c = a + b * t crosses zero, with b = num / den
+    int64_t minutes = (num * e->sum_t - den * e->sum_c) / (n * num);
+    if (minutes > UINT16_MAX * 2) {
+        minutes = UINT16_MAX * 2;
+    }
+    *empty = e->base + (time_t)minutes * 60;
+    return true;
 }
 
 void draw_battery_duration(int duration_min)
 {
-	static char battdur_text[] = "12D12H"; //battery duration
+	static char battdur_text[sizeof("12D12H")]; //battery duration
+	char text[sizeof(battdur_text)];
+
+	time_t empty;
 
-	if (!battery_plugged) { 
-		int duration_hour = duration_min / 60;
-		snprintf(battdur_text, sizeof(battdur_text),
+	if (!battery_plugged && discharge_empty_at(&discharge, &empty)) {
+		time_t now = time(NULL);
+		unsigned int remaining_hour = empty > now ? (unsigned int)(empty - now) / 3600 : 0;
+		if (remaining_hour > 9 * 24 + 23) {
+			remaining_hour = 9 * 24 + 23;
+		}
+		snprintf(text, sizeof(text),
+			BATTERY_REMAINING_FORMAT, remaining_hour / 24, remaining_hour % 24);
+	} else if (!battery_plugged) { 
+		// The text has room for two digit days
+		unsigned int duration_hour = duration_min > 0 ? duration_min / 60 : 0;
+		if (duration_hour > 99 * 24 + 23) {
+			duration_hour = 99 * 24 + 23;
+		}
+		snprintf(text, sizeof(text),
 			BATTERY_DURATION_FORMAT, duration_hour / 24, duration_hour % 24);
 	} else { //charging
-		snprintf(battdur_text, sizeof(battdur_text),
-			BATTERY_CHARGING_FORMAT, duration_min / 60, duration_min % 60);
+		unsigned int charging_min = duration_min > 0 ? duration_min : 0;
+		if (charging_min > 99 * 60 + 59) {
+			charging_min = 99 * 60 + 59;
+		}
+		snprintf(text, sizeof(text),
+			BATTERY_CHARGING_FORMAT, charging_min / 60, charging_min % 60);
 	}
-	text_layer_set_text(battery_duration_layer, battdur_text);
+	set_text_if_changed(battery_duration_layer, battdur_text, sizeof(battdur_text), text);
 }
 
+/*
+ * Persistent storage
+ */
+void storage_flush(void *data) {
+    Storage storage = {
+        .version = STORAGE_VERSION,
+        .last_charge = (int32_t)last_charge,
+        .discharge = discharge,
+        .events = events,
+    };
+
+    storage_timer = NULL;
+    storage_unsaved = false;
+    persist_write_data(STORAGE_PKEY, &storage, sizeof(storage));
+}
+
+// Bursts of changes, like a flaky charger contact, end up as one flash write
+void storage_changed(void) {
+    if (storage_timer) {
+        app_timer_reschedule(storage_timer, STORAGE_FLUSH_MS);
+    }
+    else {
+        storage_timer = app_timer_register(STORAGE_FLUSH_MS, storage_flush, NULL);
+    }
+}
+
+void storage_load(time_t now) {
+    Storage storage;
+    int size = persist_read_data(STORAGE_PKEY, &storage, sizeof(storage));
+
+    // Older versions are a prefix of this one, take what they have
+    if (size >= (int)offsetof(Storage, discharge) && storage.version >= 1) {
+        last_charge = storage.last_charge;
+        if (size >= (int)offsetof(Storage, events) && storage.version >= 2) {
+            discharge = storage.discharge;
+        }
+        if (size == sizeof(storage) && storage.version == STORAGE_VERSION) {
+            events = storage.events;
+        }
+        else {
+            storage_flush(NULL);
+        }
+    }
+    else if (persist_exists(LAST_CHARGE_PKEY)) {
+        last_charge = persist_read_int(LAST_CHARGE_PKEY);
+        storage_flush(NULL);
+        persist_delete(LAST_CHARGE_PKEY);
+    }
+    else {
+        last_charge = now;
+        storage_flush(NULL);
+    }
+}
+
+/*
+ * Event markers
+ */
+// Move the counts to start at day, dropping the days before it
+void events_rebase(int32_t day) {
+    uint8_t count[EVENT_DAYS] = { 0 };
+
+    for (int i = 0; i < EVENT_DAYS; i++) {
+        int32_t old = day + i - events.day;
+        if (old >= 0 && old < EVENT_DAYS) {
+            count[i] = events.count[old];
+        }
+    }
+    memcpy(events.count, count, sizeof(count));
+    events.day = day;
+}
+
+void events_received(DictionaryIterator *iterator, void *context) {
+    Tuple *day = dict_find(iterator, KEY_EVENT_DAY);
+    Tuple *delta = dict_find(iterator, KEY_EVENT_DELTA);
+
+    if (!day) {
+        return;
+    }
+    // The phone rebases its copy of what the watch has the same way
+    if (dict_find(iterator, KEY_EVENT_RESET)) {
+        memset(events.count, 0, sizeof(events.count));
+        events_retries = EVENT_RETRIES;
+        if (events_retry_timer) {
+            app_timer_cancel(events_retry_timer);
+            events_retry_timer = NULL;
+        }
+    }
+    else if (events.day == 0) {
+        // A delta against a baseline this watch never got, wait for the
+        // full sync the request asks for
+        return;
+    }
+    events_rebase(day->value->int32);
+    for (int i = 0; delta && i + 1 < delta->length; i += 2) {
+        const uint8_t *pair = delta->value->data + i;
+        uint8_t index = pair[0];
+        uint8_t count = pair[1];
+        if (index < EVENT_DAYS) {
+            events.count[index] = count < EVENT_MAX ? count : EVENT_MAX;
+        }
+    }
+    frame_request(FRAME_CALENDAR);
+    storage_changed();
+}
+
+void events_request(void);
+
+static void events_retry_fired(void *data) {
+    events_retry_timer = NULL;
+    events_request();
+}
+
+// Try the request again a while later, it often goes out before the phone
+// side is running. The next start asks again if all tries fail.
+static void events_retry(void) {
+    if (events_retries < EVENT_RETRIES && !events_retry_timer) {
+        events_retries++;
+        events_retry_timer = app_timer_register(EVENT_RETRY_MS << (events_retries - 1),
+            events_retry_fired, NULL);
+    }
+}
+
+void events_send_failed(DictionaryIterator *iterator, AppMessageResult reason, void *context) {
+    if (dict_find(iterator, KEY_EVENT_REQUEST)) {
+        events_retry();
+    }
+}
+
+// Ask for everything when there is nothing cached. Otherwise the phone
+// sends what changed on its own schedule, a few times a day. The request
+// carries the week start, so the phone's strip starts where this one does.
+void events_request(void) {
+    DictionaryIterator *iterator;
+
+    if (app_message_outbox_begin(&iterator) != APP_MSG_OK) {
+        events_retry();
+        return;
+    }
+    dict_write_uint8(iterator, KEY_EVENT_REQUEST, 1);
+    dict_write_uint8(iterator, KEY_EVENT_WEEK_START, CALENDAR_WEEK_START);
+    if (app_message_outbox_send() != APP_MSG_OK) {
+        events_retry();
+    }
+}
+
+/*
+ * Tick scheduling
+ */
+FrameChanges tick_update_time(struct tm *tick_time) {
+    frame_time = *tick_time;
+    return FRAME_TIME;
+}
+
+FrameChanges tick_update_date(struct tm *tick_time) {
+    frame_time = *tick_time;
+    return FRAME_DATE;
+}
+
+FrameChanges tick_update_battery(struct tm *tick_time) {
+    time_t now = time(NULL);
+    battery_duration = (int)(now - last_charge) / 60;
+    return FRAME_DURATION;
+}
+
+static TickElement tick_table[] = {
+    [TICK_TIME] = { MINUTE_UNIT, tick_update_time },
+    // Built after the first frame, see main_window_load_deferred()
+    [TICK_DATE] = { 0, tick_update_date },
+    // Every minute, also while discharging: the hours count from the last
+    // charge, not from the top of the hour. set_text_if_changed() drops the
+    // minutes that don't change the text.
+    [TICK_BATTERY] = { 0, tick_update_battery },
+};
+
 /*
  * Battery icon callback handler
  */
@@ -224,31 +700,58 @@ void battery_layer_update_callback(Layer *layer, GContext *ctx) {
     graphics_context_set_fill_color(ctx, GColorWhite);
     graphics_context_set_stroke_color(ctx, GColorWhite);
 
-    for (unsigned int i = 0; i < battery_level / 10; i++) {
+    for (unsigned int i = 0; i < battery_dots; i++) {
         graphics_fill_circle(ctx, battery_dot_points[i], 3);
     }
 
-    for (unsigned int i = battery_level / 10; i < 10; i++) {
+    for (unsigned int i = battery_dots; i < 10; i++) {
         graphics_draw_circle(ctx, battery_dot_points[i], 3);
     }
 }
 
+// Take the dots of a charge level, false if the layer shows them already
+bool show_battery_dots(uint8_t percent) {
+    uint8_t dots = percent / 10;
+
+    if (dots == battery_dots) {
+        return false;
+    }
+    battery_dots = dots;
+    return true;
+}
+
 void battery_state_handler(BatteryChargeState charge) {
     static bool last_battery_plugged;
+    time_t now = time(NULL);
+    FrameChanges changes = 0;
+    uint8_t last_battery_level = battery_level;
     battery_level = charge.charge_percent;
     last_battery_plugged = battery_plugged;
     battery_plugged = charge.is_plugged;
 
-    layer_mark_dirty(battery_layer);
+    // Only the dots are drawn there; plugging in shows in the duration text
+    if (battery_level / 10 != battery_dots) {
+        changes |= FRAME_BATTERY;
+    }
 
 	// start or stop charging
     if (last_battery_plugged ^ battery_plugged) {
-        time_t now = time(NULL);
         last_charge = now;
-        persist_write_int(LAST_CHARGE_PKEY, last_charge);
+        discharge_reset(&discharge);
+        storage_changed();
         battery_duration = 0;
-        draw_battery_duration(battery_duration);
+        changes |= FRAME_DURATION;
+    }
+
+    // Repeated readings of the same percent add nothing to the fit. The
+    // samples stay in RAM until the next plug edge or exit, a flash write
+    // for each percent would be a hundred a charge.
+    if (!battery_plugged && (battery_level != last_battery_level || !discharge.count)) {
+        discharge_add(&discharge, now, battery_level);
+        storage_unsaved = true;
+        changes |= FRAME_DURATION;
     }
+    frame_request(changes);
 }
 
 /*
@@ -256,18 +759,28 @@ void battery_state_handler(BatteryChargeState charge) {
  */
 void bluetooth_layer_update_callback(Layer *layer, GContext *ctx) {
 	graphics_context_set_compositing_mode(ctx, GCompOpAssign);
-	if (bluetoothConnected) {
-		graphics_draw_bitmap_in_rect(ctx, icon_bluetooth_linked, GRect(0, 0, 14, 12));
+	if (icon_bluetooth) {
+		graphics_draw_bitmap_in_rect(ctx, icon_bluetooth, GRect(0, 0, 14, 12));
 	}
-	else {
-		graphics_draw_bitmap_in_rect(ctx, icon_bluetooth_unlinked, GRect(0, 0, 14, 12));
+}
+
+void show_bluetooth_icon(bool connected) {
+	uint32_t id = connected ? RESOURCE_ID_BLUETOOTH_LINKED : RESOURCE_ID_BLUETOOTH_UNLINKED;
+
+	if (id == icon_bluetooth_id) {
+		return;
 	}
+	icon_bluetooth = resource_cache_bitmap(id);
+	if (icon_bluetooth_id) {
+		resource_cache_discard(icon_bluetooth_id);
+	}
+	icon_bluetooth_id = id;
 }
 
-void bluetooth_connection_handler(bool connected) {
+// Only the first disconnect that held vibrates until the next connect
+static void bluetooth_changed(void) {
 	static char vibrate = false;
-	bluetoothConnected = connected;
-	if (bluetoothConnected) {
+	if (bluetooth_connected) {
 		vibrate = false;
 	}
 	else if (!vibrate) {
@@ -275,46 +788,54 @@ void bluetooth_connection_handler(bool connected) {
 		vibes_short_pulse();
 		vibrate = true;
 	}
-	layer_mark_dirty(bluetooth_layer);
+	frame_request(FRAME_BLUETOOTH);
 }
 
-void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
-	if (units_changed & DAY_UNIT) {
-		draw_date(tick_time);
-		layer_mark_dirty(calendar_layer);
-	}
-
-	if (units_changed & MINUTE_UNIT) {
-		time_t now = time(NULL);
-		battery_duration = (int)(now - last_charge) / 60;
-		draw_battery_duration(battery_duration);
-		draw_time(tick_time);
-	}
+/*
+ * One render pass for everything the handlers noted since the last
+ */
+static void frame_apply(FrameChanges changes) {
+    if (changes & FRAME_TIME) {
+        draw_time(&frame_time);
+    }
+    if (changes & FRAME_DATE) {
+        draw_date(&frame_time);
+        update_calendar(&frame_time);
+    }
+    if (changes & (FRAME_DATE | FRAME_CALENDAR)) {
+        calendar_cached = false;
+        layer_mark_dirty(calendar_layer);
+    }
+    if ((changes & FRAME_BATTERY) && show_battery_dots(battery_level)) {
+        layer_mark_dirty(battery_layer);
+    }
+    if (changes & FRAME_DURATION) {
+        draw_battery_duration(battery_duration);
+    }
+    if (changes & FRAME_BLUETOOTH) {
+        show_bluetooth_icon(bluetooth_connected);
+        layer_mark_dirty(bluetooth_layer);
+    }
 }
 
-static void main_window_load(Window *window)
+/*
+ * Everything but the time, built once the first frame is out
+ */
+static void main_window_load_deferred(void *data)
 {
     time_t now = time(NULL);
     struct tm *current_time = localtime(&now);
     Layer *window_layer = window_get_root_layer(window);
-    GRect window_bounds = layer_get_bounds(window_layer);
 
-    // Fonts
-    time_font = fonts_load_custom_font(resource_get_handle(TIME_FONT));
-    date_font = fonts_load_custom_font(resource_get_handle(DATE_FONT));
+    startup_timer = NULL;
+    startup_done = true;
 
-    // Digital time
-    time_layer = text_layer_create(GRect(0, 28, window_bounds.size.w, 70));
-    text_layer_set_text_color(time_layer, GColorWhite);
-    text_layer_set_text_alignment(time_layer, GTextAlignmentCenter);
-    text_layer_set_background_color(time_layer, GColorClear);
-    text_layer_set_font(time_layer, time_font);
-    layer_add_child(window_layer, text_layer_get_layer(time_layer));
+    // Fonts
+    date_font = resource_cache_font(DATE_FONT);
+    calendar_font = fonts_get_system_font(CALENDAR_FONT);
 
     // Date
-    date_layer = text_layer_create(GRect(8,
-        window_bounds.size.h - CALENDAR_LAYER_HEIGHT - 25,
-        window_bounds.size.w * 2 / 3, 25));
+    date_layer = text_layer_create(LAYOUT_DATE);
     text_layer_set_text_color(date_layer, GColorWhite);
     text_layer_set_text_alignment(date_layer, GTextAlignmentLeft);
     text_layer_set_background_color(date_layer, GColorClear);
@@ -325,26 +846,15 @@ static void main_window_load(Window *window)
 	BatteryChargeState initial = battery_state_service_peek();
 	battery_level = initial.charge_percent;
 	battery_plugged = initial.is_plugged;
-	battery_layer = layer_create(GRect(0, 0, window_bounds.size.w - 28, 20)); //24*12
-    for (unsigned int i = 0; i < 10; i++) {
-        battery_dot_points[i] = GPoint (
-			(i + 1) * layer_get_bounds(battery_layer).size.w / 11,
-			layer_get_bounds(battery_layer).size.h / 2
-        );
-    }
+	show_battery_dots(battery_level);
+	battery_layer = layer_create(LAYOUT_BATTERY);
 	layer_set_update_proc(battery_layer, &battery_layer_update_callback);
 	layer_add_child(window_layer, battery_layer);
 
     // Battery duration
-	if (persist_exists(LAST_CHARGE_PKEY)) {
-		last_charge = persist_read_int(LAST_CHARGE_PKEY);
-	} else {
-		last_charge = now;
-		persist_write_int(LAST_CHARGE_PKEY, last_charge);
-	}
+	storage_load(now);
 	battery_duration = (int)(now - last_charge) / 60;
-	battery_duration_layer = text_layer_create(GRect(window_bounds.size.w * 2 / 3,
-		window_bounds.size.h - CALENDAR_LAYER_HEIGHT - 25, window_bounds.size.w / 3, 25));
+	battery_duration_layer = text_layer_create(LAYOUT_DURATION);
 	text_layer_set_text_color(battery_duration_layer, GColorWhite);
 	text_layer_set_text_alignment(battery_duration_layer, GTextAlignmentLeft);
 	text_layer_set_background_color(battery_duration_layer, GColorClear);
@@ -353,39 +863,99 @@ static void main_window_load(Window *window)
 	draw_battery_duration(battery_duration);
 
     // Bluetooth
-	icon_bluetooth_linked = gbitmap_create_with_resource(RESOURCE_ID_BLUETOOTH_LINKED);
-	icon_bluetooth_unlinked = gbitmap_create_with_resource(RESOURCE_ID_BLUETOOTH_UNLINKED);
-	bluetoothConnected = bluetooth_connection_service_peek();
-	bluetooth_layer = layer_create(GRect(window_bounds.size.w - 24, 4, 14, 12)); //14*12
+	bluetooth_start();
+	show_bluetooth_icon(bluetooth_connected);
+	bluetooth_layer = layer_create(LAYOUT_BLUETOOTH);
 	layer_set_update_proc(bluetooth_layer, &bluetooth_layer_update_callback);
 	layer_add_child(window_layer, bluetooth_layer);
 
     // Calendar
-    calendar_layer = layer_create(
-        GRect(0, window_bounds.size.h - CALENDAR_LAYER_HEIGHT,
-              window_bounds.size.w, CALENDAR_LAYER_HEIGHT)
-    );
+    calendar_layer = layer_create(LAYOUT_CALENDAR);
     layer_set_update_proc(calendar_layer, &calendar_layer_update);
     layer_add_child(window_layer, calendar_layer);
-
-    draw_time(current_time);
+    update_calendar(current_time);
     draw_date(current_time);
+
+    // Event markers
+    app_message_register_inbox_received(&events_received);
+    app_message_register_outbox_failed(&events_send_failed);
+    app_message_open(EVENT_INBOX_SIZE, EVENT_OUTBOX_SIZE);
+    if (events.day == 0) {
+        events_retries = 0;
+        events_request();
+    }
+
+    tick_table[TICK_DATE].unit = DAY_UNIT;
+    tick_set_unit(TICK_BATTERY, MINUTE_UNIT);
+    battery_state_service_subscribe(&battery_state_handler);
+    PROFILE_STOP(startup);
 }
 
-static void main_window_unload(Window *window) {
-	gbitmap_destroy(icon_bluetooth_linked);
-	gbitmap_destroy(icon_bluetooth_unlinked);
+static void main_window_load(Window *window)
+{
+    time_t now = time(NULL);
+    Layer *window_layer = window_get_root_layer(window);
+
+    // Digital time
+    time_font = resource_cache_font(TIME_FONT);
+    time_layer = layer_create(LAYOUT_TIME);
+    layer_set_update_proc(time_layer, &time_layer_update);
+    layer_add_child(window_layer, time_layer);
+    draw_time(localtime(&now));
+}
+
+static void main_window_unload_deferred(void) {
+    // Back to the time alone, as main_window_load() starts
+    tick_table[TICK_DATE].unit = 0;
+    tick_table[TICK_BATTERY].unit = 0;
+    app_message_deregister_callbacks();
+    if (events_retry_timer) {
+        app_timer_cancel(events_retry_timer);
+        events_retry_timer = NULL;
+    }
     text_layer_destroy(date_layer);
-    text_layer_destroy(time_layer);
 	text_layer_destroy(battery_duration_layer);
     layer_destroy(calendar_layer);
+    gbitmap_destroy(calendar_bitmap);
+    calendar_bitmap = NULL;
+    calendar_cached = false;
 	layer_destroy(battery_layer);
 	layer_destroy(bluetooth_layer);
-    fonts_unload_custom_font(time_font);
-    fonts_unload_custom_font(date_font);
+	resource_cache_release(icon_bluetooth_id);
+	icon_bluetooth = NULL;
+	icon_bluetooth_id = 0;
+    resource_cache_release(DATE_FONT);
+}
+
+static void main_window_unload(Window *window) {
+    frame_cancel();
+    if (startup_timer) {
+        app_timer_cancel(startup_timer);
+        startup_timer = NULL;
+    }
+    if (startup_done) {
+        main_window_unload_deferred();
+        startup_done = false;
+    }
+    layer_destroy(time_layer);
+    resource_cache_release(TIME_FONT);
+    resource_cache_flush();
 }
 
+#ifdef CONFIG_PROFILE
+void profile_tap_handler(AccelAxisType axis, int32_t direction) {
+    if (PROFILE_TRIPLE_TAP()) {
+        PROFILE_DUMP(calendar_layer_update);
+        PROFILE_DUMP(tick_handler);
+        PROFILE_DUMP(first_frame);
+        PROFILE_DUMP(startup);
+    }
+}
+#endif
+
 static void init() {
+    PROFILE_START(first_frame);
+    PROFILE_START(startup);
 
     // Window
     window = window_create();
@@ -393,21 +963,32 @@ static void init() {
         .load = main_window_load,
         .unload = main_window_unload
     });
-    window_stack_push(window, true /* Animated */);
+    // Not animated, so the first frame is the face itself
+    window_stack_push(window, false);
     window_set_background_color(window, GColorBlack);
 
-    tick_timer_service_subscribe(MINUTE_UNIT | HOUR_UNIT | DAY_UNIT, &tick_handler);
-    battery_state_service_subscribe(&battery_state_handler);
-    bluetooth_connection_service_subscribe(&bluetooth_connection_handler);
+    TICK_START(tick_table);
+#ifdef CONFIG_PROFILE
+    accel_tap_service_subscribe(&profile_tap_handler);
+#endif
 }
 
 /*
  * deinit
  */
 static void deinit() {
-    bluetooth_connection_service_unsubscribe();
+#ifdef CONFIG_PROFILE
+    accel_tap_service_unsubscribe();
+#endif
+    if (storage_timer) {
+        app_timer_cancel(storage_timer);
+    }
+    if (storage_timer || storage_unsaved) {
+        storage_flush(NULL);
+    }
+    bluetooth_stop();
     battery_state_service_unsubscribe();
-    tick_timer_service_unsubscribe();
+    tick_stop();
     window_destroy(window);
 }
 
@@ -418,4 +999,5 @@ int main(void) {
     init();
     app_event_loop();
     deinit();
+    return 0;
 }
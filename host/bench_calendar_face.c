@@ -0,0 +1,181 @@
+/*
+ * Render benchmark for calendar_face. The face is compiled into this
+ * translation unit so its update procs and state can be driven directly.
+ */
+#include "host.h"
+
+#define main calendar_face_main
+#include "../calendar_face/src/main.c"
+#undef main
+
+#include "legacy_calendar.h"
+
+// Walk a day per frame so every month layout gets exercised
+static void set_day(int frame) {
+	time_t t = 1466796600 + (time_t)(frame % 1461) * 86400;
+
+	host_set_time(t);
+	update_calendar(localtime(&t));
+}
+
+static void bench_update_calendar(GContext *ctx, int frame) {
+	(void)ctx;
+	set_day(frame);
+}
+
+// Four years of days, so the calendar code is timed without localtime()
+#define BENCH_DAYS 1461
+static struct tm s_days[BENCH_DAYS];
+static CalendarGrid s_grid;
+static volatile int s_sink;
+
+static void bench_get_calendar(GContext *ctx, int frame) {
+	int days[14];
+
+	legacy_get_calendar(days, &s_days[frame % BENCH_DAYS]);
+	s_sink = days[frame % 14];
+}
+
+static void bench_calendar_build(GContext *ctx, int frame) {
+	calendar_build(&s_grid, CALENDAR_TWO_WEEKS, 0, calendar_day_number(&s_days[frame % BENCH_DAYS]));
+	s_sink = s_grid.mday[frame % 14];
+}
+
+static void bench_calendar_build_month(GContext *ctx, int frame) {
+	calendar_build(&s_grid, CALENDAR_MONTH, 0, calendar_day_number(&s_days[frame % BENCH_DAYS]));
+	s_sink = s_grid.mday[frame % 28];
+}
+
+// A day on from the last, as at DAY_UNIT
+static void bench_calendar_set_today(GContext *ctx, int frame) {
+	calendar_set_today(&s_grid, calendar_day_number(&s_days[frame % BENCH_DAYS]));
+	s_sink = s_grid.mday[frame % 14];
+}
+
+static void bench_calendar_layer_update(GContext *ctx, int frame) {
+	set_day(frame);
+	calendar_layer_update(calendar_layer, ctx);
+}
+
+static void bench_calendar_layer_redraw(GContext *ctx, int frame) {
+	(void)frame;
+	calendar_layer_update(calendar_layer, ctx);
+}
+
+static void bench_time_layer_update(GContext *ctx, int frame) {
+	time_t t = 1466796600 + (time_t)frame * 60;
+
+	draw_time(localtime(&t));
+	time_layer_update(time_layer, ctx);
+}
+
+static void bench_battery_layer_update(GContext *ctx, int frame) {
+	show_battery_dots(frame % 101);
+	battery_layer_update_callback(battery_layer, ctx);
+}
+
+// Straight to the icon swap: a connection change through host_set_bluetooth()
+// would only show after BLUETOOTH_SETTLE_MS
+static int s_icon_swaps;
+
+static void bench_bluetooth_toggle(GContext *ctx, int frame) {
+	uint32_t shown = icon_bluetooth_id;
+
+	show_bluetooth_icon(frame % 2);
+	s_icon_swaps += icon_bluetooth_id != shown;
+	bluetooth_layer_update_callback(bluetooth_layer, ctx);
+}
+
+static void bench_full_frame(GContext *ctx, int frame) {
+	(void)ctx;
+	host_advance_time(1466796600 + (time_t)(frame + 1) * 60);
+	host_render_frame();
+}
+
+// A flaky charger contact: a few bursts of plug edges a day
+static void check_charger_bounce(void) {
+	HostStats before = host_stats;
+	time_t start = time(NULL);
+	int edges = 0;
+
+	for (int m = 1; m <= 24 * 60; m++) {
+		if (m % (8 * 60) == 0) {
+			for (int s = 0; s < 10; s++, edges++) {
+				host_advance_time(start + (time_t)m * 60 + s);
+				host_set_battery((BatteryChargeState) { .charge_percent = 80, .is_plugged = !(edges % 2) });
+			}
+		}
+		host_advance_time(start + (time_t)m * 60 + 30);
+	}
+	host_advance_time(start + (24 * 60 + 1) * 60);
+	printf("  charger bounce: %d plug edges, %llu flash writes in a day\n", edges,
+		(unsigned long long)(host_stats.persist_writes - before.persist_writes));
+}
+
+// The service reporting a drop three times, two seconds apart, is one
+// change: it settles BLUETOOTH_SETTLE_MS after the first report and counts
+// no flaps
+static int check_bluetooth_repeats(void) {
+	time_t start = time(NULL);
+	uint32_t flaps = bluetooth_flaps;
+
+	for (int i = 0; i < 3; i++) {
+		host_advance_time(start + i * 2);
+		host_set_bluetooth(false);
+	}
+	host_advance_time(start + BLUETOOTH_SETTLE_MS / 1000 + 1);
+	host_render_frame();
+	if (bluetooth_connected || bluetooth_flaps != flaps) {
+		printf("  bluetooth repeats: %s, %u flaps\n", bluetooth_connected ? "not settled" : "settled",
+			(unsigned)(bluetooth_flaps - flaps));
+		return 1;
+	}
+	host_set_bluetooth(true);
+	host_advance_time(start + 2 * BLUETOOTH_SETTLE_MS / 1000 + 2);
+	host_render_frame();
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	int frames = argc > 1 ? atoi(argv[1]) : 5000;
+
+	host_set_time(1466796600); // 2016-06-24 19:30:00 UTC
+	host_bench_startup(init);
+	host_bench_snapshot("calendar_face");
+
+	for (int i = 0; i < BENCH_DAYS; i++) {
+		time_t t = 1466796600 + (time_t)i * 86400;
+		s_days[i] = *gmtime(&t);
+	}
+
+	host_bench_header("calendar_face");
+	host_bench_run("get_calendar (before)", frames, NULL, bench_get_calendar);
+	host_bench_run("calendar_build", frames, NULL, bench_calendar_build);
+	host_bench_run("calendar_build month", frames, NULL, bench_calendar_build_month);
+	calendar_build(&s_grid, CALENDAR_TWO_WEEKS, 0, calendar_day_number(&s_days[0]));
+	host_bench_run("calendar_set_today", frames, NULL, bench_calendar_set_today);
+	host_bench_run("update_calendar", frames, calendar_layer, bench_update_calendar);
+	host_bench_run("calendar_layer_update", frames, calendar_layer, bench_calendar_layer_update);
+	host_bench_run("calendar_layer_update cached", frames, calendar_layer, bench_calendar_layer_redraw);
+	host_bench_run("time_layer_update", frames, time_layer, bench_time_layer_update);
+	host_bench_run("battery_layer_update", frames, battery_layer, bench_battery_layer_update);
+	host_bench_run("bluetooth toggle", frames, bluetooth_layer, bench_bluetooth_toggle);
+	show_bluetooth_icon(bluetooth_connected);
+	if (s_icon_swaps != frames) {
+		printf("  bluetooth toggle: the icon changed in %d of %d frames\n", s_icon_swaps, frames);
+		return 1;
+	}
+	host_bench_run("full frame", frames, NULL, bench_full_frame);
+	host_bench_ticks(24 * 60);
+	bluetooth_flaps = 0;
+	host_bench_bluetooth_flaps(11);
+	printf("  bluetooth flaps: %u counted by the face\n", (unsigned)bluetooth_flaps);
+	host_bench_battery_drain();
+	check_charger_bounce();
+	if (check_bluetooth_repeats()) {
+		return 1;
+	}
+
+	deinit();
+	return 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * Render benchmark for thins. The face is compiled into this translation
+ * unit so its static update procs and state can be driven directly.
+ */
+#include "host.h"
+
+#define main thins_main
+#include "../thins/src/main.c"
+#undef main
+
+// Variants built with extra CONFIG_* options name themselves
+#ifndef BENCH_NAME
+#define BENCH_NAME "thins"
+#endif
+
+// One tick per frame of whatever unit the face subscribes to
+#ifdef BENCH_SECONDS
+#define TICK_SECONDS 1
+#else
+#define TICK_SECONDS 60
+#endif
+
+static void set_time(int frame) {
+	s_time.hours = (frame / 60) % 24;
+	s_time.minutes = frame % 60;
+	s_time.seconds = frame % 60;
+}
+
+static void bench_bg_update_proc(GContext *ctx, int frame) {
+	set_time(frame);
+	bg_update_proc(s_bg_layer, ctx);
+}
+
+static void bench_bg_update_proc_uncached(GContext *ctx, int frame) {
+	set_time(frame);
+	s_dial_bucket = -1;
+	bg_update_proc(s_bg_layer, ctx);
+}
+
+static void bench_draw_proc(GContext *ctx, int frame) {
+	set_time(frame);
+	draw_proc(s_canvas_layer, ctx);
+}
+
+static void bench_full_frame(GContext *ctx, int frame) {
+	(void)ctx;
+#ifdef BENCH_SECONDS
+	// Flick again whenever the burst has run out
+	if (!s_show_seconds) {
+		host_accel_tap(ACCEL_AXIS_Y, 1);
+	}
+#endif
+	host_advance_time(1466796600 + (time_t)(frame + 1) * TICK_SECONDS);
+	host_render_frame();
+}
+
+#ifndef BENCH_SECONDS
+// A flick switches to second ticks and the timeout switches back
+static int check_seconds_burst(void) {
+	time_t start = time(NULL);
+	uint64_t wakeups = host_stats.wakeups;
+	int burst = SECOND_HAND_TIMEOUT_MS / 1000;
+
+	host_accel_tap(ACCEL_AXIS_X, 1);
+	for(int s = 1; s <= burst + 60; s++) {
+		host_advance_time(start + s);
+		if (s == burst - 1 && (!s_show_seconds || host_tick_units() != SECOND_UNIT)) {
+			printf("  seconds burst: not in second ticks after %d s\n", s);
+			return 1;
+		}
+	}
+	if (s_show_seconds || host_tick_units() != MINUTE_UNIT) {
+		printf("  seconds burst: still in second ticks after %d s\n", burst + 60);
+		return 1;
+	}
+	printf("  seconds burst: %d s of second ticks, %llu wakeups in %d s\n",
+		burst, (unsigned long long)(host_stats.wakeups - wakeups), burst + 60);
+	return 0;
+}
+#endif
+
+int main(int argc, char **argv) {
+	int frames = argc > 1 ? atoi(argv[1]) : 5000;
+
+	host_set_time(1466796600); // 2016-06-24 19:30:00 UTC
+	init();
+#ifdef BENCH_SECONDS
+	host_accel_tap(ACCEL_AXIS_Y, 1);
+#endif
+	host_render_frame();
+	host_bench_snapshot(BENCH_NAME);
+
+	host_bench_header(BENCH_NAME);
+	host_bench_run("bg_update_proc", frames, s_bg_layer, bench_bg_update_proc);
+	host_bench_run("bg_update_proc uncached", frames, s_bg_layer, bench_bg_update_proc_uncached);
+	host_bench_run("draw_proc", frames, s_canvas_layer, bench_draw_proc);
+	host_bench_run("full frame", frames, NULL, bench_full_frame);
+	host_bench_ticks(24 * 60);
+	host_bench_bluetooth_flaps(11);
+	printf("  bluetooth flaps: %u counted by the face\n", (unsigned)bluetooth_flaps);
+	host_bench_battery_drain();
+#ifndef BENCH_SECONDS
+	if (check_seconds_burst()) {
+		return 1;
+	}
+#endif
+
+#ifdef CONFIG_DAMAGE_TRACKING
+	// After all those partial frames the screen must match a full redraw
+	uint32_t incremental = host_framebuffer_hash();
+	s_full_redraw = true;
+	layer_mark_dirty(s_canvas_layer);
+	host_render_frame();
+	if (incremental != host_framebuffer_hash()) {
+		printf("  damage tracking: frame differs from a full redraw\n");
+		return 1;
+	}
+	printf("  damage tracking: frame matches a full redraw\n");
+#endif
+
+	deinit();
+	return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Harness side of the host SDK: simulated clock and services, render
+ * counters and a small benchmark runner shared by the bench_* drivers.
+ */
+#pragma once
+
+#include "pebble.h"
+
+#ifdef HOST_PLATFORM_CHALK
+#define HOST_SCREEN_WIDTH 180
+#define HOST_SCREEN_HEIGHT 180
+#define HOST_FB_BYTES_PER_ROW 24
+#else
+#define HOST_SCREEN_WIDTH 144
+#define HOST_SCREEN_HEIGHT 168
+#define HOST_FB_BYTES_PER_ROW 20
+#endif
+// Aplite's app heap, heap_bytes_free() counts down from it
+#define HOST_HEAP_BYTES 24576
+
+typedef struct {
+	uint64_t lines;
+	uint64_t texts;
+	uint64_t circles;
+	uint64_t rects;
+	uint64_t bitmaps;
+	uint64_t pixels;
+	uint64_t frames;
+	uint64_t dirty_marks;
+	uint64_t text_sets;
+	uint64_t wakeups;
+	uint64_t persist_reads;
+	uint64_t persist_writes;
+	uint64_t vibes;
+	uint64_t resource_loads;
+	uint64_t messages_in;    // AppMessages from the phone, each acked
+	uint64_t messages_out;   // AppMessages to the phone
+} HostStats;
+
+extern HostStats host_stats;
+
+// Simulated environment. Advancing the clock fires the app timers that
+// come due on the way, then the tick handler if its unit changed.
+void host_set_time(time_t t);
+void host_advance_time(time_t t);
+// Run the event loop to t: every tick and timer on the way fires at its own
+// time and the frame is rendered after each, as on the watch. What comes
+// due at t is left for the caller to render with the events it delivers
+// at t, since the watch queues them together.
+void host_run_until(time_t t);
+// Fire the timers due by now, as the watch does before it sleeps again
+void host_run_pending(void);
+void host_set_24h_style(bool is_24h);
+void host_set_battery(BatteryChargeState state);
+void host_set_bluetooth(bool connected);
+void host_accel_tap(AccelAxisType axis, int32_t direction);
+TimeUnits host_tick_units(void);
+// AppMessage: hand the face a dictionary from the phone, false if it was
+// dropped, and take the one it last sent, returning its size or 0. Or nack
+// the one it last sent, false if there is none.
+bool host_app_message_receive(const uint8_t *dictionary, uint16_t size);
+uint16_t host_app_message_take(uint8_t *buffer, uint16_t size);
+bool host_app_message_fail(AppMessageResult reason);
+
+// Rendering
+GBitmap *host_framebuffer(void);
+GContext *host_layer_context(Layer *layer);
+// Fires the timers due first, as they were queued before the redraw
+bool host_render_frame(void);
+uint32_t host_framebuffer_hash(void);
+bool host_write_pbm(const char *path);
+
+// Benchmarks
+typedef void (*HostBenchProc)(GContext *ctx, int frame);
+
+void host_bench_snapshot(const char *face);
+void host_bench_header(const char *face);
+void host_bench_run(const char *name, int frames, Layer *layer, HostBenchProc proc);
+void host_bench_startup(void (*init)(void));
+void host_bench_ticks(int minutes);
+void host_bench_bluetooth_flaps(int events);
+void host_bench_battery_drain(void);
@@ -0,0 +1,84 @@
+/*
+ * get_calendar() and days_in_month() as calendar_face had them before
+ * src/calendar.h, renamed. verify_calendar checks the engine against them
+ * and bench_calendar_face times it against them.
+ */
+#pragma once
+
+#include <time.h>
+
+// How many days are/were in the month
+static int legacy_days_in_month(int mon, int year) {
+    mon++; // dec = 0|12, lazily optimized
+    switch (mon) {
+        // April, June, September and November have 30 Days
+        case 4:
+        case 6:
+        case 9:
+        case 11:
+            return 30;
+        // Deal with Feburary & Leap years
+        case 2:
+            if (year % 400 == 0) {
+                return 29;
+            } else if (year % 100 == 0) {
+                return 28;
+            } else if (year % 4 == 0) {
+                return 29;
+            } else {
+                return 28;
+            }
+        // Most months have 31 days
+        default:
+            return 31;
+    }
+}
+
+static void legacy_get_calendar(int calendar[14], struct tm *current_time)
+{
+    int mon = current_time->tm_mon;
+    int year = current_time->tm_year + 1900;
+    int daysThisMonth = legacy_days_in_month(mon, year);
+    int i, cellNum = 0;   // address for current day table cell: 0-20
+    int daysVisPrevMonth = 0;
+    int daysVisNextMonth = 0;
+    int daysPriorToToday = current_time->tm_wday; // just instantiating, not final value
+    int daysAfterToday   = (6 - current_time->tm_wday) % 7 + 7; // just instantiating, not final value
+
+    if (daysPriorToToday >= current_time->tm_mday) {
+        // We're showing more days before today than exist this month
+        int daysInPrevMonth = legacy_days_in_month(mon - 1,year); // year only matters for February, which will be the same 'from' March
+
+        // Number of days we'll show from the previous month
+        daysVisPrevMonth = daysPriorToToday - current_time->tm_mday + 1;
+
+        for (i = 0; i < daysVisPrevMonth; i++, cellNum++) {
+            calendar[cellNum] = daysInPrevMonth + i - daysVisPrevMonth + 1;
+        }
+    }
+
+    // optimization: instantiate i to a hot mess, since the first day we show this month may not be the 1st of the month
+    int firstDayShownThisMonth = daysVisPrevMonth + current_time->tm_mday - daysPriorToToday;
+    for (i = firstDayShownThisMonth; i < current_time->tm_mday; i++, cellNum++) {
+        calendar[cellNum] = i;
+    }
+
+    // the current day... we'll style this special
+    calendar[cellNum] = current_time->tm_mday;
+    cellNum++;
+
+    if (current_time->tm_mday + daysAfterToday > daysThisMonth) {
+        daysVisNextMonth = current_time->tm_mday + daysAfterToday - daysThisMonth;
+    }
+
+    // add the days after today until the end of the month/next week, to our array...
+    int daysLeftThisMonth = daysAfterToday - daysVisNextMonth;
+    for (i = 0; i < daysLeftThisMonth; i++, cellNum++) {
+        calendar[cellNum] = i + current_time->tm_mday + 1;
+    }
+
+    // add any days in the next month to our array...
+    for (i = 0; i < daysVisNextMonth; i++, cellNum++) {
+        calendar[cellNum] = i + 1;
+    }
+}
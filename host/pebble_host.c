@@ -0,0 +1,1628 @@
+/*
+ * Software implementation of the Pebble SDK subset declared in pebble.h.
+ *
+ * Everything is drawn into one 144x168 1bpp framebuffer with the aplite
+ * layout (LSB first, 20 bytes per row), or 180x180 for HOST_PLATFORM_CHALK. The drawing primitives are plain
+ * reference rasterizers: they are not pixel exact with the firmware, but
+ * they touch a comparable number of pixels and count every call, which is
+ * what the benchmarks report.
+ */
+#include <math.h>
+#include <stdarg.h>
+
+#include "pebble_host.h"
+
+HostStats host_stats;
+
+static uint8_t s_fb_data[HOST_SCREEN_HEIGHT * HOST_FB_BYTES_PER_ROW];
+static GBitmap s_fb = {
+	.data = s_fb_data,
+	.bytes_per_row = HOST_FB_BYTES_PER_ROW,
+	.format = GBitmapFormat1Bit,
+	.bounds = { { 0, 0 }, { HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT } },
+};
+static GContext s_ctx;
+
+static time_t s_now;
+static bool s_24h_style = true;
+static Window *s_top_window;
+static bool s_frame_dirty;
+
+// Milliseconds since the epoch, s_now is its whole seconds
+static uint64_t s_now_ms;
+// When the CPU last woke for an event. It stays up until the app's queue
+// is empty, so a timer due by then runs without waking it again.
+static uint64_t s_awake_ms;
+static TimeUnits s_tick_units;
+static TickHandler s_tick_handler;
+static BatteryChargeState s_battery = { .charge_percent = 80 };
+static BatteryStateHandler s_battery_handler;
+static bool s_bluetooth = true;
+static BluetoothConnectionHandler s_bluetooth_handler;
+static AccelTapHandler s_accel_tap_handler;
+
+#define HOST_MAX_TIMERS 8
+
+struct AppTimer {
+	bool used;
+	uint64_t deadline_ms;
+	AppTimerCallback callback;
+	void *data;
+};
+
+static AppTimer s_timers[HOST_MAX_TIMERS];
+
+/*
+ * App heap. Objects the stubs create for the face are counted so
+ * heap_bytes_used() reports what the face holds, as on the watch.
+ */
+static size_t s_heap_used;
+
+static void *heap_calloc(size_t count, size_t size) {
+	size_t *block = calloc(1, sizeof(size_t) + count * size);
+
+	*block = count * size;
+	s_heap_used += *block;
+	return block + 1;
+}
+
+static void heap_free(void *ptr) {
+	size_t *block = ptr;
+
+	if (!ptr) {
+		return;
+	}
+	s_heap_used -= block[-1];
+	free(block - 1);
+}
+
+size_t heap_bytes_used(void) {
+	return s_heap_used;
+}
+
+size_t heap_bytes_free(void) {
+	return s_heap_used < HOST_HEAP_BYTES ? HOST_HEAP_BYTES - s_heap_used : 0;
+}
+
+/*
+ * Geometry
+ */
+GPoint grect_center_point(const GRect *rect) {
+	return GPoint(rect->origin.x + rect->size.w / 2, rect->origin.y + rect->size.h / 2);
+}
+
+bool grect_equal(const GRect * const rect_a, const GRect * const rect_b) {
+	return rect_a->origin.x == rect_b->origin.x && rect_a->origin.y == rect_b->origin.y &&
+		rect_a->size.w == rect_b->size.w && rect_a->size.h == rect_b->size.h;
+}
+
+bool gpoint_equal(const GPoint * const point_a, const GPoint * const point_b) {
+	return point_a->x == point_b->x && point_a->y == point_b->y;
+}
+
+static GRect rect_intersect(GRect a, GRect b) {
+	int x0 = a.origin.x > b.origin.x ? a.origin.x : b.origin.x;
+	int y0 = a.origin.y > b.origin.y ? a.origin.y : b.origin.y;
+	int x1 = a.origin.x + a.size.w < b.origin.x + b.size.w ? a.origin.x + a.size.w : b.origin.x + b.size.w;
+	int y1 = a.origin.y + a.size.h < b.origin.y + b.size.h ? a.origin.y + a.size.h : b.origin.y + b.size.h;
+
+	if (x1 <= x0 || y1 <= y0) {
+		return GRectZero;
+	}
+	return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+/*
+ * Trigonometry
+ */
+// As the firmware does it: a quarter wave table, mirrored and negated for
+// the rest of the circle
+int32_t sin_lookup(int32_t angle) {
+	static int32_t quarter[TRIG_MAX_ANGLE / 4 + 1];
+	static bool ready = false;
+	uint32_t a = angle < 0 ? 0u - (uint32_t)angle : (uint32_t)angle;
+	int32_t sign = angle < 0 ? -1 : 1;
+
+	if (!ready) {
+		for (int i = 0; i <= TRIG_MAX_ANGLE / 4; i++) {
+			quarter[i] = (int32_t)lround(sin(2.0 * M_PI * i / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+		}
+		ready = true;
+	}
+	a %= TRIG_MAX_ANGLE;
+	if (a >= TRIG_MAX_ANGLE / 2) {
+		a -= TRIG_MAX_ANGLE / 2;
+		sign = -sign;
+	}
+	if (a > TRIG_MAX_ANGLE / 4) {
+		a = TRIG_MAX_ANGLE / 2 - a;
+	}
+	return sign * quarter[a];
+}
+
+int32_t cos_lookup(int32_t angle) {
+	return sin_lookup(angle + TRIG_MAX_ANGLE / 4);
+}
+
+/*
+ * Bitmaps
+ */
+static bool bitmap_get(const GBitmap *bitmap, int x, int y) {
+	return (bitmap->data[y * bitmap->bytes_per_row + x / 8] >> (x % 8)) & 1;
+}
+
+static void bitmap_put(GBitmap *bitmap, int x, int y, bool white) {
+	uint8_t *byte = &bitmap->data[y * bitmap->bytes_per_row + x / 8];
+	uint8_t mask = 1 << (x % 8);
+
+	if (white) {
+		*byte |= mask;
+	} else {
+		*byte &= ~mask;
+	}
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+	GBitmap *bitmap;
+
+	if (format != GBitmapFormat1Bit) {
+		return NULL;
+	}
+	bitmap = heap_calloc(1, sizeof(GBitmap));
+	bitmap->bytes_per_row = ((size.w + 31) / 32) * 4;
+	bitmap->data = heap_calloc(size.h, bitmap->bytes_per_row);
+	bitmap->format = format;
+	bitmap->bounds = GRect(0, 0, size.w, size.h);
+	bitmap->owns_data = true;
+	return bitmap;
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+	ResHandle res = resource_get_handle(resource_id);
+	GBitmap *bitmap;
+
+	if (!res || res->type != HOST_RESOURCE_BITMAP) {
+		return NULL;
+	}
+	host_stats.resource_loads++;
+	bitmap = gbitmap_create_blank(GSize(res->width, res->height), GBitmapFormat1Bit);
+	// Only 1 bit images come with pixels, others just have their dimensions
+	if (bitmap && res->data) {
+		memcpy(bitmap->data, res->data, (size_t)res->height * bitmap->bytes_per_row);
+	}
+	return bitmap;
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect) {
+	GBitmap *bitmap = heap_calloc(1, sizeof(GBitmap));
+
+	*bitmap = *base_bitmap;
+	bitmap->bounds = rect_intersect(base_bitmap->bounds, GRect(
+		base_bitmap->bounds.origin.x + sub_rect.origin.x,
+		base_bitmap->bounds.origin.y + sub_rect.origin.y,
+		sub_rect.size.w, sub_rect.size.h));
+	bitmap->owns_data = false;
+	return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+	if (!bitmap) {
+		return;
+	}
+	if (bitmap->owns_data) {
+		heap_free(bitmap->data);
+	}
+	heap_free(bitmap);
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) {
+	return bitmap->data;
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+	return bitmap->bytes_per_row;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+	return bitmap->format;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+	return bitmap->bounds;
+}
+
+// As on the watch, a sub-bitmap's bounds are in its parent's pixels
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds) {
+	bitmap->bounds = bounds;
+}
+
+/*
+ * Fonts and resources
+ */
+GFont fonts_get_system_font(const char *font_key) {
+	static struct HostFont fonts[16];
+	static int count = 0;
+	const char *digits = font_key + strcspn(font_key, "0123456789");
+
+	for (int i = 0; i < count; i++) {
+		if (strcmp(fonts[i].key, font_key) == 0) {
+			return &fonts[i];
+		}
+	}
+	if (count == (int)(sizeof(fonts) / sizeof(fonts[0]))) {
+		return &fonts[0];
+	}
+	fonts[count].key = font_key;
+	fonts[count].height = *digits ? atoi(digits) : 14;
+	return &fonts[count++];
+}
+
+GFont fonts_load_custom_font(ResHandle handle) {
+	GFont font = heap_calloc(1, sizeof(struct HostFont));
+
+	host_stats.resource_loads++;
+	font->key = handle ? handle->name : "";
+	font->height = handle && handle->font_height ? handle->font_height : 14;
+	font->custom = true;
+	return font;
+}
+
+void fonts_unload_custom_font(GFont font) {
+	if (font && font->custom) {
+		heap_free(font);
+	}
+}
+
+ResHandle resource_get_handle(uint32_t resource_id) {
+	for (uint32_t i = 0; host_resources[i].name; i++) {
+		if (i + 1 == resource_id) {
+			return &host_resources[i];
+		}
+	}
+	return NULL;
+}
+
+size_t resource_size(ResHandle handle) {
+	return handle ? handle->size : 0;
+}
+
+/*
+ * Graphics
+ */
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+	ctx->stroke_color = color;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+	ctx->fill_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+	ctx->text_color = color;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+	ctx->compositing_mode = mode;
+}
+
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width) {
+	ctx->stroke_width = stroke_width ? stroke_width : 1;
+}
+
+void graphics_context_set_antialiased(GContext *ctx, bool enable) {
+	(void)ctx;
+	(void)enable;
+}
+
+static inline void put_pixel(GContext *ctx, int x, int y, GColor color) {
+	const GRect *clip = &ctx->clip;
+
+	x += ctx->offset.x;
+	y += ctx->offset.y;
+	if (color == GColorClear || x < clip->origin.x || y < clip->origin.y ||
+			x >= clip->origin.x + clip->size.w || y >= clip->origin.y + clip->size.h) {
+		return;
+	}
+	bitmap_put(ctx->dest, x, y, color == GColorWhite);
+	host_stats.pixels++;
+}
+
+static void put_span(GContext *ctx, int x0, int x1, int y, GColor color) {
+	const GRect *clip = &ctx->clip;
+
+	x0 += ctx->offset.x;
+	x1 += ctx->offset.x;
+	y += ctx->offset.y;
+	if (color == GColorClear || y < clip->origin.y || y >= clip->origin.y + clip->size.h) {
+		return;
+	}
+	if (x0 < clip->origin.x) {
+		x0 = clip->origin.x;
+	}
+	if (x1 >= clip->origin.x + clip->size.w) {
+		x1 = clip->origin.x + clip->size.w - 1;
+	}
+	for (int x = x0; x <= x1; x++) {
+		bitmap_put(ctx->dest, x, y, color == GColorWhite);
+		host_stats.pixels++;
+	}
+}
+
+static void put_disc(GContext *ctx, int cx, int cy, int radius, GColor color) {
+	for (int dy = -radius; dy <= radius; dy++) {
+		int dx = (int)sqrt((double)(radius * radius + radius - dy * dy));
+		put_span(ctx, cx - dx, cx + dx, cy + dy, color);
+	}
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+	put_pixel(ctx, point.x, point.y, ctx->stroke_color);
+}
+
+// Narrow [*lo, *hi] to the x where lo_bound <= a * x + b <= hi_bound
+static void clamp_linear(double a, double b, double lo_bound, double hi_bound, double *lo, double *hi) {
+	if (a == 0) {
+		if (b < lo_bound || b > hi_bound) {
+			*lo = 1;
+			*hi = 0;
+		}
+		return;
+	}
+	double x0 = (lo_bound - b) / a, x1 = (hi_bound - b) / a;
+	if (x0 > x1) {
+		double tmp = x0;
+		x0 = x1;
+		x1 = tmp;
+	}
+	*lo = x0 > *lo ? x0 : *lo;
+	*hi = x1 < *hi ? x1 : *hi;
+}
+
+/*
+ * Wide strokes are filled as a capsule around the segment, one write per
+ * pixel. Like the firmware, even widths are rounded down to the odd width
+ * below them.
+ */
+static void draw_wide_line(GContext *ctx, GPoint p0, GPoint p1, int width) {
+	double r = (width % 2 ? width : width - 1) / 2.0;
+	double dx = p1.x - p0.x, dy = p1.y - p0.y;
+	double len = sqrt(dx * dx + dy * dy);
+	int y0 = (int)floor((p0.y < p1.y ? p0.y : p1.y) - r);
+	int y1 = (int)ceil((p0.y > p1.y ? p0.y : p1.y) + r);
+
+	// Each row crosses the capsule in one span: the union of the spans
+	// through both end discs and through the body between them
+	for (int y = y0; y <= y1; y++) {
+		double left = INFINITY, right = -INFINITY;
+		const GPoint *ends[] = { &p0, &p1 };
+
+		for (int i = 0; i < 2; i++) {
+			double h2 = r * r - (y - ends[i]->y) * (y - ends[i]->y);
+			if (h2 >= 0) {
+				left = fmin(left, ends[i]->x - sqrt(h2));
+				right = fmax(right, ends[i]->x + sqrt(h2));
+			}
+		}
+		if (len > 0) {
+			double lo = -INFINITY, hi = INFINITY;
+			clamp_linear(dy / len, -((y - p0.y) * dx + p0.x * dy) / len, -r, r, &lo, &hi);
+			clamp_linear(dx / len, ((y - p0.y) * dy - p0.x * dx) / len, 0, len, &lo, &hi);
+			if (lo <= hi) {
+				left = fmin(left, lo);
+				right = fmax(right, hi);
+			}
+		}
+		if (left <= right && ceil(left - 1e-9) <= floor(right + 1e-9)) {
+			put_span(ctx, (int)ceil(left - 1e-9), (int)floor(right + 1e-9), y, ctx->stroke_color);
+		}
+	}
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+	int x = p0.x, y = p0.y;
+	int dx = abs(p1.x - p0.x), sx = p0.x < p1.x ? 1 : -1;
+	int dy = -abs(p1.y - p0.y), sy = p0.y < p1.y ? 1 : -1;
+	int err = dx + dy;
+
+	host_stats.lines++;
+	if (ctx->stroke_width > 2) {
+		draw_wide_line(ctx, p0, p1, ctx->stroke_width);
+		return;
+	}
+	for (;;) {
+		put_pixel(ctx, x, y, ctx->stroke_color);
+		if (x == p1.x && y == p1.y) {
+			break;
+		}
+		int e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			x += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			y += sy;
+		}
+	}
+}
+
+void graphics_draw_rect(GContext *ctx, GRect rect) {
+	int x1 = rect.origin.x + rect.size.w - 1;
+	int y1 = rect.origin.y + rect.size.h - 1;
+
+	host_stats.rects++;
+	put_span(ctx, rect.origin.x, x1, rect.origin.y, ctx->stroke_color);
+	put_span(ctx, rect.origin.x, x1, y1, ctx->stroke_color);
+	for (int y = rect.origin.y + 1; y < y1; y++) {
+		put_pixel(ctx, rect.origin.x, y, ctx->stroke_color);
+		put_pixel(ctx, x1, y, ctx->stroke_color);
+	}
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+	(void)corner_radius;
+	(void)corner_mask;
+
+	host_stats.rects++;
+	for (int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+		put_span(ctx, rect.origin.x, rect.origin.x + rect.size.w - 1, y, ctx->fill_color);
+	}
+}
+
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius) {
+	int x = radius, y = 0, err = 1 - x;
+
+	host_stats.circles++;
+	while (x >= y) {
+		put_pixel(ctx, p.x + x, p.y + y, ctx->stroke_color);
+		put_pixel(ctx, p.x + y, p.y + x, ctx->stroke_color);
+		put_pixel(ctx, p.x - y, p.y + x, ctx->stroke_color);
+		put_pixel(ctx, p.x - x, p.y + y, ctx->stroke_color);
+		put_pixel(ctx, p.x - x, p.y - y, ctx->stroke_color);
+		put_pixel(ctx, p.x - y, p.y - x, ctx->stroke_color);
+		put_pixel(ctx, p.x + y, p.y - x, ctx->stroke_color);
+		put_pixel(ctx, p.x + x, p.y - y, ctx->stroke_color);
+		y++;
+		if (err < 0) {
+			err += 2 * y + 1;
+		} else {
+			x--;
+			err += 2 * (y - x) + 1;
+		}
+	}
+}
+
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius) {
+	host_stats.circles++;
+	put_disc(ctx, p.x, p.y, radius, ctx->fill_color);
+}
+
+static bool composite(GCompOp mode, bool src, bool dst) {
+	switch (mode) {
+		case GCompOpAssignInverted:
+			return !src;
+		case GCompOpOr:
+			return dst || src;
+		case GCompOpAnd:
+			return dst && src;
+		case GCompOpClear:
+			return dst && !src;
+		case GCompOpSet:
+			return dst || !src;
+		case GCompOpAssign:
+		default:
+			return src;
+	}
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+	GRect src = bitmap->bounds;
+	GRect dst = rect_intersect(ctx->clip, GRect(rect.origin.x + ctx->offset.x,
+		rect.origin.y + ctx->offset.y, rect.size.w, rect.size.h));
+	int src_dx = src.origin.x - (rect.origin.x + ctx->offset.x);
+	int src_dy = src.origin.y - (rect.origin.y + ctx->offset.y);
+
+	host_stats.bitmaps++;
+	if (dst.size.w <= 0 || src.size.w <= 0 || src.size.h <= 0) {
+		return;
+	}
+
+	// Untiled, byte aligned copies are done a row at a time like the firmware blitter
+	if (ctx->compositing_mode == GCompOpAssign && rect.size.w <= src.size.w &&
+			rect.size.h <= src.size.h && (dst.origin.x + src_dx) % 8 == 0 &&
+			dst.origin.x % 8 == 0 && dst.size.w % 8 == 0) {
+		for (int y = dst.origin.y; y < dst.origin.y + dst.size.h; y++) {
+			memcpy(&ctx->dest->data[y * ctx->dest->bytes_per_row + dst.origin.x / 8],
+				&bitmap->data[(y + src_dy) * bitmap->bytes_per_row + (dst.origin.x + src_dx) / 8],
+				dst.size.w / 8);
+		}
+		host_stats.pixels += (uint64_t)dst.size.w * dst.size.h;
+		return;
+	}
+
+	for (int y = dst.origin.y; y < dst.origin.y + dst.size.h; y++) {
+		int sy = src.origin.y + (y - rect.origin.y - ctx->offset.y) % src.size.h;
+		for (int x = dst.origin.x; x < dst.origin.x + dst.size.w; x++) {
+			int sx = src.origin.x + (x - rect.origin.x - ctx->offset.x) % src.size.w;
+			bool d = bitmap_get(ctx->dest, x, y);
+			bool value = composite(ctx->compositing_mode, bitmap_get(bitmap, sx, sy), d);
+			if (value != d || ctx->compositing_mode == GCompOpAssign ||
+					ctx->compositing_mode == GCompOpAssignInverted) {
+				bitmap_put(ctx->dest, x, y, value);
+				host_stats.pixels++;
+			}
+		}
+	}
+}
+
+/*
+ * Text is rendered as outlined glyph boxes with a middle bar, roughly the
+ * ink and the per-pixel work of a real glyph of the same size.
+ */
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+		const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+		GTextAttributes *text_attributes) {
+	int height = font ? font->height : 14;
+	int advance = height * 9 / 20;
+	int glyph_w = advance - 1 > 1 ? advance - 1 : 1;
+	int glyph_h = height * 2 / 3;
+	int width = (int)strlen(text) * advance;
+	int x = box.origin.x;
+	int y = box.origin.y + height / 4;
+	GRect clip = ctx->clip;
+
+	(void)overflow_mode;
+	(void)text_attributes;
+
+	host_stats.texts++;
+	if (alignment == GTextAlignmentCenter) {
+		x += (box.size.w - width) / 2;
+	} else if (alignment == GTextAlignmentRight) {
+		x += box.size.w - width;
+	}
+
+	ctx->clip = rect_intersect(clip, GRect(box.origin.x + ctx->offset.x,
+		box.origin.y + ctx->offset.y, box.size.w, box.size.h));
+	for (const char *c = text; *c; c++, x += advance) {
+		if (*c == ' ') {
+			continue;
+		}
+		for (int gy = 0; gy < glyph_h; gy++) {
+			for (int gx = 0; gx < glyph_w; gx++) {
+				if (gx == 0 || gy == 0 || gx == glyph_w - 1 || gy == glyph_h - 1 || gy == glyph_h / 2) {
+					put_pixel(ctx, x + gx, y + gy, ctx->text_color);
+				}
+			}
+		}
+	}
+	ctx->clip = clip;
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+	return ctx->dest;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+	return buffer == ctx->dest;
+}
+
+void host_raw_pixels(uint32_t count) {
+	host_stats.pixels += count;
+}
+
+/*
+ * Layers
+ */
+Layer *layer_create(GRect frame) {
+	return layer_create_with_data(frame, 0);
+}
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+	Layer *layer = heap_calloc(1, sizeof(Layer));
+
+	layer->frame = frame;
+	layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+	layer->data = data_size ? heap_calloc(1, data_size) : NULL;
+	return layer;
+}
+
+void layer_destroy(Layer *layer) {
+	if (!layer) {
+		return;
+	}
+	layer_remove_from_parent(layer);
+	heap_free(layer->data);
+	heap_free(layer);
+}
+
+void layer_mark_dirty(Layer *layer) {
+	(void)layer;
+	host_stats.dirty_marks++;
+	s_frame_dirty = true;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+	layer->update_proc = update_proc;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+	layer->frame = frame;
+	layer->bounds.size = frame.size;
+	layer_mark_dirty(layer);
+}
+
+GRect layer_get_frame(const Layer *layer) {
+	return layer->frame;
+}
+
+void layer_set_bounds(Layer *layer, GRect bounds) {
+	layer->bounds = bounds;
+	layer_mark_dirty(layer);
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+	return layer->bounds;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+	Layer **link = &parent->first_child;
+
+	layer_remove_from_parent(child);
+	while (*link) {
+		link = &(*link)->next_sibling;
+	}
+	*link = child;
+	child->parent = parent;
+	layer_mark_dirty(parent);
+}
+
+void layer_remove_from_parent(Layer *child) {
+	Layer **link;
+
+	if (!child->parent) {
+		return;
+	}
+	for (link = &child->parent->first_child; *link; link = &(*link)->next_sibling) {
+		if (*link == child) {
+			*link = child->next_sibling;
+			break;
+		}
+	}
+	child->parent = NULL;
+	child->next_sibling = NULL;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+	if (layer->hidden != hidden) {
+		layer->hidden = hidden;
+		layer_mark_dirty(layer);
+	}
+}
+
+bool layer_get_hidden(const Layer *layer) {
+	return layer->hidden;
+}
+
+void *layer_get_data(const Layer *layer) {
+	return layer->data;
+}
+
+static void text_layer_update_proc(Layer *layer, GContext *ctx) {
+	TextLayer *text_layer = (TextLayer *)layer;
+
+	if (text_layer->background_color != GColorClear) {
+		graphics_context_set_fill_color(ctx, text_layer->background_color);
+		graphics_fill_rect(ctx, layer->bounds, 0, GCornerNone);
+	}
+	if (text_layer->text && *text_layer->text) {
+		graphics_context_set_text_color(ctx, text_layer->text_color);
+		graphics_draw_text(ctx, text_layer->text, text_layer->font, layer->bounds,
+			text_layer->overflow_mode, text_layer->alignment, NULL);
+	}
+}
+
+TextLayer *text_layer_create(GRect frame) {
+	TextLayer *text_layer = heap_calloc(1, sizeof(TextLayer));
+
+	text_layer->layer.frame = frame;
+	text_layer->layer.bounds = GRect(0, 0, frame.size.w, frame.size.h);
+	text_layer->layer.update_proc = text_layer_update_proc;
+	text_layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14);
+	text_layer->text_color = GColorBlack;
+	text_layer->background_color = GColorWhite;
+	return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+	if (!text_layer) {
+		return;
+	}
+	layer_remove_from_parent(&text_layer->layer);
+	heap_free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+	return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+	text_layer->text = text;
+	host_stats.text_sets++;
+	layer_mark_dirty(&text_layer->layer);
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+	return text_layer->text;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+	text_layer->background_color = color;
+	layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+	text_layer->text_color = color;
+	layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+	text_layer->alignment = text_alignment;
+	layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_overflow_mode(TextLayer *text_layer, GTextOverflowMode line_mode) {
+	text_layer->overflow_mode = line_mode;
+	layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+	text_layer->font = font;
+	layer_mark_dirty(&text_layer->layer);
+}
+
+/*
+ * Windows
+ */
+Window *window_create(void) {
+	Window *window = heap_calloc(1, sizeof(Window));
+
+	window->root.frame = s_fb.bounds;
+	window->root.bounds = s_fb.bounds;
+	window->background_color = GColorWhite;
+	return window;
+}
+
+void window_destroy(Window *window) {
+	if (!window) {
+		return;
+	}
+	if (window->loaded && window->handlers.unload) {
+		window->handlers.unload(window);
+	}
+	if (s_top_window == window) {
+		s_top_window = NULL;
+	}
+	heap_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+	window->handlers = handlers;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+	return (Layer *)&window->root;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+	window->background_color = background_color;
+	layer_mark_dirty(&window->root);
+}
+
+void window_stack_push(Window *window, bool animated) {
+	(void)animated;
+
+	s_top_window = window;
+	if (!window->loaded) {
+		window->loaded = true;
+		if (window->handlers.load) {
+			window->handlers.load(window);
+		}
+	}
+	if (window->handlers.appear) {
+		window->handlers.appear(window);
+	}
+	layer_mark_dirty(&window->root);
+}
+
+void app_event_loop(void) {
+}
+
+/*
+ * Rendering
+ */
+static void reset_context(GContext *ctx, GPoint offset, GRect clip) {
+	ctx->dest = &s_fb;
+	ctx->offset = offset;
+	ctx->clip = rect_intersect(clip, s_fb.bounds);
+	ctx->stroke_color = GColorBlack;
+	ctx->fill_color = GColorBlack;
+	ctx->text_color = GColorBlack;
+	ctx->compositing_mode = GCompOpAssign;
+	ctx->stroke_width = 1;
+}
+
+static void render_layer(Layer *layer, GPoint origin, GRect clip) {
+	GRect frame = GRect(origin.x + layer->frame.origin.x, origin.y + layer->frame.origin.y,
+		layer->frame.size.w, layer->frame.size.h);
+	GPoint draw_origin = GPoint(frame.origin.x + layer->bounds.origin.x,
+		frame.origin.y + layer->bounds.origin.y);
+
+	if (layer->hidden) {
+		return;
+	}
+	clip = rect_intersect(clip, frame);
+	if (clip.size.w <= 0) {
+		return;
+	}
+	if (layer->update_proc) {
+		reset_context(&s_ctx, draw_origin, clip);
+		layer->update_proc(layer, &s_ctx);
+	}
+	for (Layer *child = layer->first_child; child; child = child->next_sibling) {
+		render_layer(child, draw_origin, clip);
+	}
+}
+
+GBitmap *host_framebuffer(void) {
+	return &s_fb;
+}
+
+static GPoint layer_draw_origin(const Layer *layer) {
+	GPoint origin = layer->parent ? layer_draw_origin(layer->parent) : GPointZero;
+
+	origin.x += layer->frame.origin.x + layer->bounds.origin.x;
+	origin.y += layer->frame.origin.y + layer->bounds.origin.y;
+	return origin;
+}
+
+GContext *host_layer_context(Layer *layer) {
+	GPoint origin = layer_draw_origin(layer);
+
+	reset_context(&s_ctx, origin, GRect(origin.x - layer->bounds.origin.x,
+		origin.y - layer->bounds.origin.y, layer->frame.size.w, layer->frame.size.h));
+	return &s_ctx;
+}
+
+bool host_render_frame(void) {
+	host_run_pending();
+	if (!s_frame_dirty || !s_top_window) {
+		return false;
+	}
+	s_frame_dirty = false;
+	host_stats.frames++;
+
+	// A clear window keeps the previous frame underneath its layers
+	if (s_top_window->background_color != GColorClear) {
+		reset_context(&s_ctx, GPointZero, s_fb.bounds);
+		graphics_context_set_fill_color(&s_ctx, s_top_window->background_color);
+		graphics_fill_rect(&s_ctx, s_fb.bounds, 0, GCornerNone);
+	}
+	render_layer(&s_top_window->root, GPointZero, s_fb.bounds);
+	return true;
+}
+
+uint32_t host_framebuffer_hash(void) {
+	uint32_t hash = 2166136261u;
+
+	for (int y = 0; y < HOST_SCREEN_HEIGHT; y++) {
+		for (int x = 0; x < HOST_SCREEN_WIDTH; x++) {
+			hash = (hash ^ bitmap_get(&s_fb, x, y)) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+bool host_write_pbm(const char *path) {
+	FILE *f = fopen(path, "w");
+
+	if (!f) {
+		return false;
+	}
+	fprintf(f, "P1\n%d %d\n", HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT);
+	for (int y = 0; y < HOST_SCREEN_HEIGHT; y++) {
+		for (int x = 0; x < HOST_SCREEN_WIDTH; x++) {
+			fputc(bitmap_get(&s_fb, x, y) ? '0' : '1', f);
+		}
+		fputc('\n', f);
+	}
+	fclose(f);
+	return true;
+}
+
+/*
+ * Time
+ */
+time_t host_time(time_t *tloc) {
+	if (tloc) {
+		*tloc = s_now;
+	}
+	return s_now;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+	uint16_t ms = (uint16_t)(s_now_ms % 1000);
+
+	if (tloc) {
+		*tloc = (time_t)(s_now_ms / 1000);
+	}
+	if (out_ms) {
+		*out_ms = ms;
+	}
+	return ms;
+}
+
+void host_set_time(time_t t) {
+	static bool tz_ready = false;
+
+	// Bench output must not depend on the machine's timezone
+	if (!tz_ready) {
+		setenv("TZ", "UTC", 1);
+		tzset();
+		tz_ready = true;
+	}
+	s_now = t;
+	s_now_ms = (uint64_t)t * 1000;
+}
+
+static void wake(void) {
+	host_stats.wakeups++;
+	s_awake_ms = s_now_ms;
+}
+
+// Fire, in order, every timer due by target_ms, moving the clock to each
+static void run_timers(uint64_t target_ms) {
+	for(;;) {
+		AppTimer *next = NULL;
+
+		for(int i = 0; i < HOST_MAX_TIMERS; i++) {
+			if (s_timers[i].used && s_timers[i].deadline_ms <= target_ms &&
+					(!next || s_timers[i].deadline_ms < next->deadline_ms)) {
+				next = &s_timers[i];
+			}
+		}
+		if (!next) {
+			return;
+		}
+		next->used = false;
+		if (next->deadline_ms > s_now_ms) {
+			s_now_ms = next->deadline_ms;
+			s_now = (time_t)(s_now_ms / 1000);
+		}
+		if (next->deadline_ms > s_awake_ms) {
+			wake();
+		}
+		next->callback(next->data);
+	}
+}
+
+void host_advance_time(time_t t) {
+	struct tm before = *localtime(&s_now);
+	struct tm after = *localtime(&t);
+	TimeUnits changed = 0;
+
+	// Timers see the clock at their deadline, ticks see it at t
+	run_timers((uint64_t)t * 1000);
+	s_now = t;
+	s_now_ms = (uint64_t)t * 1000;
+	if (before.tm_year != after.tm_year) {
+		changed |= YEAR_UNIT;
+	}
+	if (changed || before.tm_mon != after.tm_mon) {
+		changed |= MONTH_UNIT;
+	}
+	if (changed || before.tm_mday != after.tm_mday) {
+		changed |= DAY_UNIT;
+	}
+	if (changed || before.tm_hour != after.tm_hour) {
+		changed |= HOUR_UNIT;
+	}
+	if (changed || before.tm_min != after.tm_min) {
+		changed |= MINUTE_UNIT;
+	}
+	if (changed || before.tm_sec != after.tm_sec) {
+		changed |= SECOND_UNIT;
+	}
+	if (s_tick_handler && (changed & s_tick_units)) {
+		wake();
+		s_tick_handler(&after, changed);
+	}
+}
+
+// The next time after now at which the subscribed tick fires
+static time_t next_tick(time_t now) {
+	// The host clock is UTC, so days start on multiples of 86400
+	if (s_tick_units & SECOND_UNIT) {
+		return now + 1;
+	}
+	if (s_tick_units & MINUTE_UNIT) {
+		return now - now % 60 + 60;
+	}
+	if (s_tick_units & HOUR_UNIT) {
+		return now - now % 3600 + 3600;
+	}
+	return now - now % 86400 + 86400;
+}
+
+void host_run_until(time_t t) {
+	while (s_now < t) {
+		time_t next = s_tick_handler ? next_tick(s_now) : t;
+
+		for(int i = 0; i < HOST_MAX_TIMERS; i++) {
+			time_t deadline = (time_t)((s_timers[i].deadline_ms + 999) / 1000);
+
+			if (s_timers[i].used && deadline < next) {
+				next = deadline > s_now ? deadline : s_now + 1;
+			}
+		}
+		if (next >= t) {
+			host_advance_time(t);
+			break;
+		}
+		host_advance_time(next);
+		host_render_frame();
+	}
+}
+
+void host_run_pending(void) {
+	run_timers(s_now_ms);
+}
+
+void host_set_24h_style(bool is_24h) {
+	s_24h_style = is_24h;
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+	s_tick_units = tick_units;
+	s_tick_handler = handler;
+}
+
+void tick_timer_service_unsubscribe(void) {
+	s_tick_units = 0;
+	s_tick_handler = NULL;
+}
+
+TimeUnits host_tick_units(void) {
+	return s_tick_handler ? s_tick_units : 0;
+}
+
+bool clock_is_24h_style(void) {
+	return s_24h_style;
+}
+
+/*
+ * Timers
+ */
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+	for(int i = 0; i < HOST_MAX_TIMERS; i++) {
+		if (!s_timers[i].used) {
+			s_timers[i] = (AppTimer) {
+				.used = true,
+				.deadline_ms = s_now_ms + timeout_ms,
+				.callback = callback,
+				.data = callback_data,
+			};
+			return &s_timers[i];
+		}
+	}
+	return NULL;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+	if (!timer_handle || !timer_handle->used) {
+		return false;
+	}
+	timer_handle->deadline_ms = s_now_ms + new_timeout_ms;
+	return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+	if (timer_handle) {
+		timer_handle->used = false;
+	}
+}
+
+/*
+ * Battery and Bluetooth
+ */
+void host_set_battery(BatteryChargeState state) {
+	s_battery = state;
+	if (s_battery_handler) {
+		wake();
+		s_battery_handler(state);
+	}
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+	s_battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+	s_battery_handler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void) {
+	return s_battery;
+}
+
+void host_set_bluetooth(bool connected) {
+	s_bluetooth = connected;
+	if (s_bluetooth_handler) {
+		wake();
+		s_bluetooth_handler(connected);
+	}
+}
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler) {
+	s_bluetooth_handler = handler;
+}
+
+void bluetooth_connection_service_unsubscribe(void) {
+	s_bluetooth_handler = NULL;
+}
+
+bool bluetooth_connection_service_peek(void) {
+	return s_bluetooth;
+}
+
+/*
+ * Accelerometer
+ */
+void host_accel_tap(AccelAxisType axis, int32_t direction) {
+	if (s_accel_tap_handler) {
+		wake();
+		s_accel_tap_handler(axis, direction);
+	}
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+	s_accel_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+	s_accel_tap_handler = NULL;
+}
+
+/*
+ * Vibes
+ */
+void vibes_short_pulse(void) {
+	host_stats.vibes++;
+}
+
+void vibes_long_pulse(void) {
+	host_stats.vibes++;
+}
+
+void vibes_double_pulse(void) {
+	host_stats.vibes++;
+}
+
+void vibes_cancel(void) {
+}
+
+/*
+ * Persistent storage
+ */
+typedef struct {
+	uint32_t key;
+	int size;
+	uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} PersistEntry;
+
+static PersistEntry s_persist[32];
+static int s_persist_count;
+
+static PersistEntry *persist_find(uint32_t key) {
+	for (int i = 0; i < s_persist_count; i++) {
+		if (s_persist[i].key == key) {
+			return &s_persist[i];
+		}
+	}
+	return NULL;
+}
+
+bool persist_exists(const uint32_t key) {
+	return persist_find(key) != NULL;
+}
+
+int persist_get_size(const uint32_t key) {
+	PersistEntry *entry = persist_find(key);
+
+	return entry ? entry->size : -1;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+	int32_t value = 0;
+
+	persist_read_data(key, &value, sizeof(value));
+	return value;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+	PersistEntry *entry = persist_find(key);
+	int size;
+
+	host_stats.persist_reads++;
+	if (!entry) {
+		return -1;
+	}
+	size = entry->size < (int)buffer_size ? entry->size : (int)buffer_size;
+	memcpy(buffer, entry->data, size);
+	return size;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+	return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+	PersistEntry *entry = persist_find(key);
+
+	if (size > PERSIST_DATA_MAX_LENGTH) {
+		return -1;
+	}
+	if (!entry) {
+		if (s_persist_count == (int)(sizeof(s_persist) / sizeof(s_persist[0]))) {
+			return -1;
+		}
+		entry = &s_persist[s_persist_count++];
+		entry->key = key;
+	}
+	host_stats.persist_writes++;
+	memcpy(entry->data, data, size);
+	entry->size = (int)size;
+	return (int)size;
+}
+
+int persist_delete(const uint32_t key) {
+	PersistEntry *entry = persist_find(key);
+
+	if (!entry) {
+		return -1;
+	}
+	*entry = s_persist[--s_persist_count];
+	return 0;
+}
+
+/*
+ * Dictionaries
+ */
+#define TUPLE_HEADER_SIZE offsetof(Tuple, value)
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t * const buffer, const uint16_t size) {
+	if (!iter || !buffer || size < 1) {
+		return DICT_INVALID_ARGS;
+	}
+	buffer[0] = 0;
+	iter->dictionary = buffer;
+	iter->end = buffer + size;
+	iter->cursor = (Tuple *)(buffer + 1);
+	return DICT_OK;
+}
+
+static DictionaryResult dict_write(DictionaryIterator *iter, uint32_t key, TupleType type, const void *data, uint16_t size) {
+	Tuple *tuple = iter->cursor;
+
+	if ((const uint8_t *)tuple + TUPLE_HEADER_SIZE + size > iter->end) {
+		return DICT_NOT_ENOUGH_STORAGE;
+	}
+	tuple->key = key;
+	tuple->type = type;
+	tuple->length = size;
+	memcpy(tuple->value, data, size);
+	iter->cursor = (Tuple *)((uint8_t *)tuple + TUPLE_HEADER_SIZE + size);
+	iter->dictionary[0]++;
+	return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t * const data, const uint16_t size) {
+	return dict_write(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value) {
+	return dict_write(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+	return dict_write(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+	iter->end = (const uint8_t *)iter->cursor;
+	return (uint32_t)(iter->end - iter->dictionary);
+}
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t * const buffer, const uint16_t size) {
+	iter->dictionary = (uint8_t *)buffer;
+	iter->end = buffer + size;
+	return dict_read_first(iter);
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+	iter->cursor = (Tuple *)(iter->dictionary + 1);
+	return iter->dictionary[0] ? iter->cursor : NULL;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+	Tuple *next = (Tuple *)((uint8_t *)iter->cursor + TUPLE_HEADER_SIZE + iter->cursor->length);
+
+	if ((const uint8_t *)next + TUPLE_HEADER_SIZE > iter->end) {
+		return NULL;
+	}
+	iter->cursor = next;
+	return next;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+	DictionaryIterator it = *iter;
+
+	for (Tuple *tuple = dict_read_first(&it); tuple; tuple = dict_read_next(&it)) {
+		if (tuple->key == key) {
+			return tuple;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * AppMessage. The phone acks every message at once, so a send completes
+ * before app_message_outbox_send() returns and the next may begin, unless
+ * host_app_message_fail() turns that into a nack.
+ */
+static uint8_t *s_inbox;
+static uint8_t *s_outbox;
+static uint32_t s_inbox_size;
+static uint32_t s_outbox_size;
+static uint16_t s_outbox_used;   // size of the last message sent, until taken
+static DictionaryIterator s_outbox_iter;
+static AppMessageInboxReceived s_inbox_handler;
+static AppMessageOutboxFailed s_outbox_failed_handler;
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+	if (s_inbox) {
+		return APP_MSG_INVALID_STATE;
+	}
+	s_inbox = heap_calloc(1, size_inbound);
+	s_outbox = heap_calloc(1, size_outbound);
+	s_inbox_size = size_inbound;
+	s_outbox_size = size_outbound;
+	return APP_MSG_OK;
+}
+
+void app_message_deregister_callbacks(void) {
+	s_inbox_handler = NULL;
+	s_outbox_failed_handler = NULL;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+	AppMessageInboxReceived previous = s_inbox_handler;
+
+	s_inbox_handler = received_callback;
+	return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+	AppMessageOutboxFailed previous = s_outbox_failed_handler;
+
+	s_outbox_failed_handler = failed_callback;
+	return previous;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+	if (!s_outbox) {
+		return APP_MSG_INVALID_STATE;
+	}
+	dict_write_begin(&s_outbox_iter, s_outbox, s_outbox_size);
+	*iterator = &s_outbox_iter;
+	return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+	if (!s_outbox) {
+		return APP_MSG_INVALID_STATE;
+	}
+	s_outbox_used = dict_write_end(&s_outbox_iter);
+	host_stats.messages_out++;
+	return APP_MSG_OK;
+}
+
+bool host_app_message_receive(const uint8_t *dictionary, uint16_t size) {
+	DictionaryIterator iterator;
+
+	if (!s_inbox || !s_inbox_handler || size > s_inbox_size) {
+		return false;
+	}
+	memcpy(s_inbox, dictionary, size);
+	dict_read_begin_from_buffer(&iterator, s_inbox, size);
+	host_stats.messages_in++;
+	wake();
+	s_inbox_handler(&iterator, NULL);
+	return true;
+}
+
+bool host_app_message_fail(AppMessageResult reason) {
+	DictionaryIterator iterator;
+	uint16_t used = s_outbox_used;
+
+	if (!used) {
+		return false;
+	}
+	s_outbox_used = 0;
+	if (s_outbox_failed_handler) {
+		dict_read_begin_from_buffer(&iterator, s_outbox, used);
+		wake();
+		s_outbox_failed_handler(&iterator, reason, NULL);
+	}
+	return true;
+}
+
+uint16_t host_app_message_take(uint8_t *buffer, uint16_t size) {
+	uint16_t used = s_outbox_used;
+
+	if (!used || used > size) {
+		return 0;
+	}
+	memcpy(buffer, s_outbox, used);
+	s_outbox_used = 0;
+	return used;
+}
+
+/*
+ * Logging
+ */
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+	static int enabled = -1;
+	va_list args;
+
+	if (enabled < 0) {
+		enabled = getenv("HOST_APP_LOG") != NULL;
+	}
+	if (!enabled) {
+		return;
+	}
+	fprintf(stderr, "[%u] %s:%d ", log_level, src_filename, src_line_number);
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+/*
+ * Benchmarks
+ */
+static double now_us(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Print the frame hash and, if HOST_PBM names a directory, save the frame
+void host_bench_snapshot(const char *face) {
+	const char *dir = getenv("HOST_PBM");
+	char path[256];
+
+	printf("%s frame hash %08x, heap %u bytes\n", face, host_framebuffer_hash(),
+		(unsigned)heap_bytes_used());
+	if (dir) {
+		snprintf(path, sizeof(path), "%s/%s.pbm", dir, face);
+		host_write_pbm(path);
+	}
+}
+
+void host_bench_header(const char *face) {
+	printf("%-28s %8s %10s %8s %8s %8s %10s\n",
+		face, "frames", "us/frame", "lines", "texts", "circles", "pixels");
+}
+
+void host_bench_run(const char *name, int frames, Layer *layer, HostBenchProc proc) {
+	HostStats before = host_stats;
+	double start, elapsed;
+
+	start = now_us();
+	for (int i = 0; i < frames; i++) {
+		proc(layer ? host_layer_context(layer) : NULL, i);
+	}
+	elapsed = now_us() - start;
+
+	printf("  %-26s %8d %10.2f %8.2f %8.2f %8.2f %10.1f\n", name, frames,
+		elapsed / frames,
+		(double)(host_stats.lines - before.lines) / frames,
+		(double)(host_stats.texts - before.texts) / frames,
+		(double)(host_stats.circles - before.circles) / frames,
+		(double)(host_stats.pixels - before.pixels) / frames);
+}
+
+static void print_startup_stage(const char *stage, double us, const HostStats *from, const HostStats *to) {
+	printf("  startup %-12s %8.1f us, %llu resource loads, %llu persist reads, %llu pixels\n", stage, us,
+		(unsigned long long)(to->resource_loads - from->resource_loads),
+		(unsigned long long)(to->persist_reads - from->persist_reads),
+		(unsigned long long)(to->pixels - from->pixels));
+}
+
+// Start the face, then give it a second for what it builds after its first frame
+void host_bench_startup(void (*init)(void)) {
+	HostStats before = host_stats, first;
+	double start = now_us(), first_us;
+
+	init();
+	host_render_frame();
+	first_us = now_us() - start;
+	first = host_stats;
+	host_run_until(s_now + 1);
+	host_render_frame();
+	print_startup_stage("first frame", first_us, &before, &first);
+	print_startup_stage("complete", now_us() - start, &before, &host_stats);
+}
+
+// Run the clock a minute at a time and count what the tick handler caused
+void host_bench_ticks(int minutes) {
+	HostStats before = host_stats;
+	time_t start = time(NULL);
+
+	for (int m = 1; m <= minutes; m++) {
+		host_advance_time(start + (time_t)m * 60);
+		host_render_frame();
+	}
+	printf("  minute ticks: %d minutes, %llu text sets, %llu dirty marks, %llu frames\n", minutes,
+		(unsigned long long)(host_stats.text_sets - before.text_sets),
+		(unsigned long long)(host_stats.dirty_marks - before.dirty_marks),
+		(unsigned long long)(host_stats.frames - before.frames));
+}
+
+// Flip the connection once a second, ending disconnected, then let it settle
+void host_bench_bluetooth_flaps(int events) {
+	HostStats before = host_stats;
+	time_t start = time(NULL);
+
+	for (int i = 1; i <= events; i++) {
+		host_advance_time(start + i);
+		host_set_bluetooth(i % 2 == 0);
+		host_render_frame();
+	}
+	host_advance_time(start + events + 30);
+	host_render_frame();
+	host_set_bluetooth(true);
+	host_advance_time(start + events + 60);
+	host_render_frame();
+	printf("  bluetooth flaps: %d flips, %llu vibes, %llu frames\n", events,
+		(unsigned long long)(host_stats.vibes - before.vibes),
+		(unsigned long long)(host_stats.frames - before.frames));
+}
+
+// Down to empty a percent at a time and back up on the charger, an event a
+// second. Each level is reported twice, as the watch does when only the
+// voltage moved.
+void host_bench_battery_drain(void) {
+	HostStats before = host_stats;
+	time_t start = time(NULL);
+	int events = 0;
+
+	for (int step = 0; step <= 200; step++) {
+		BatteryChargeState state = {
+			.charge_percent = step <= 100 ? 100 - step : step - 100,
+			.is_plugged = step > 100,
+		};
+
+		for (int i = 0; i < 2; i++) {
+			host_set_battery(state);
+			host_render_frame();
+			host_advance_time(start + ++events);
+			host_render_frame();
+		}
+	}
+	printf("  battery drain: %d charge events, %llu dirty marks, %llu frames, %llu pixels\n", events,
+		(unsigned long long)(host_stats.dirty_marks - before.dirty_marks),
+		(unsigned long long)(host_stats.frames - before.frames),
+		(unsigned long long)(host_stats.pixels - before.pixels));
+}
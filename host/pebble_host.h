@@ -0,0 +1,78 @@
+/*
+ * Private definitions of the opaque SDK types used by the host stubs.
+ */
+#pragma once
+
+#include "host.h"
+
+typedef enum {
+	HOST_RESOURCE_RAW,
+	HOST_RESOURCE_BITMAP,
+	HOST_RESOURCE_FONT,
+} HostResourceType;
+
+struct HostResource {
+	const char *name;
+	HostResourceType type;
+	uint32_t size;
+	int16_t width;
+	int16_t height;
+	int16_t font_height;
+	const uint8_t *data;    // 1 bit bitmap rows in GBitmap layout, or NULL
+};
+
+// Generated from appinfo.json, terminated by an entry with a NULL name
+extern const struct HostResource host_resources[];
+
+struct HostFont {
+	const char *key;
+	int16_t height;
+	bool custom;
+};
+
+struct GBitmap {
+	uint8_t *data;
+	uint16_t bytes_per_row;
+	GBitmapFormat format;
+	GRect bounds;
+	bool owns_data;
+};
+
+struct GContext {
+	GBitmap *dest;
+	GPoint offset;
+	GRect clip;
+	GColor stroke_color;
+	GColor fill_color;
+	GColor text_color;
+	GCompOp compositing_mode;
+	uint8_t stroke_width;
+};
+
+struct Layer {
+	GRect frame;
+	GRect bounds;
+	LayerUpdateProc update_proc;
+	Layer *parent;
+	Layer *first_child;
+	Layer *next_sibling;
+	bool hidden;
+	void *data;
+};
+
+struct TextLayer {
+	Layer layer;
+	const char *text;
+	GFont font;
+	GColor text_color;
+	GColor background_color;
+	GTextAlignment alignment;
+	GTextOverflowMode overflow_mode;
+};
+
+struct Window {
+	Layer root;
+	WindowHandlers handlers;
+	GColor background_color;
+	bool loaded;
+};
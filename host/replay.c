@@ -0,0 +1,248 @@
+/*
+ * Replays a week of battery, Bluetooth and wrist flick events through a
+ * face and weighs what it did into an estimate of the charge it cost.
+ *
+ * Built once per face with REPLAY_SOURCE naming its main.c. Without an
+ * argument the built-in week below is played; a trace file has one event
+ * per line, as seconds from the start, the event and its value. Events
+ * after the first end are not played:
+ *
+ *     # comment
+ *     0      battery 100
+ *     27000  tap
+ *     28800  bluetooth 0
+ *     30000  battery 60 charging
+ *     604800 end
+ */
+#include <stddef.h>
+
+#include "host.h"
+
+#define main face_main
+#include REPLAY_SOURCE
+#undef main
+
+#ifndef REPLAY_NAME
+#define REPLAY_NAME REPLAY_FACE
+#endif
+
+#define START 1466796600 // 2016-06-24 19:30:00 UTC
+#define DAY (24 * 3600)
+#define WEEK (7 * DAY)
+
+typedef enum {
+	EVENT_BATTERY,
+	EVENT_BLUETOOTH,
+	EVENT_TAP,
+	EVENT_END,
+} EventType;
+
+typedef struct {
+	int32_t at;     // seconds from START
+	EventType type;
+	int value;      // charge percent or connection
+	bool plugged;
+	int order;      // keeps events at the same time in trace order
+} Event;
+
+#define MAX_EVENTS 4096
+
+static Event s_events[MAX_EVENTS];
+static int s_event_count;
+
+/*
+ * What a watch spends on each thing the face makes it do, in uA*s. These
+ * are rough figures for aplite, not measurements: a wakeup runs the CPU
+ * for a few ms, a frame is composited and pushed to the display over SPI
+ * and a short vibe runs the motor for 100 ms. A pixel costs the same
+ * whether a drawing call or a raw frame buffer store wrote it, so the
+ * thins render modes are weighed alike. They are meant to rank builds
+ * against each other, not to predict battery life.
+ */
+typedef struct {
+	const char *name;
+	size_t counter;  // offset in HostStats
+	double charge;   // uA*s per count
+} EnergyWeight;
+
+static const EnergyWeight s_weights[] = {
+	{ "wakeups", offsetof(HostStats, wakeups), 30 },
+	{ "dirty marks", offsetof(HostStats, dirty_marks), 2 },
+	{ "frames", offsetof(HostStats, frames), 150 },
+	{ "pixels", offsetof(HostStats, pixels), 0.01 },
+	{ "text draws", offsetof(HostStats, texts), 25 },
+	{ "persist writes", offsetof(HostStats, persist_writes), 500 },
+	{ "vibes", offsetof(HostStats, vibes), 8000 },
+};
+
+// Aplite's cell, to put the estimate in proportion
+#define BATTERY_MAH 130
+
+static void add_event(int32_t at, EventType type, int value, bool plugged) {
+	if (s_event_count < MAX_EVENTS) {
+		s_events[s_event_count] = (Event) { at, type, value, plugged, s_event_count };
+		s_event_count++;
+	}
+}
+
+static int compare_events(const void *a, const void *b) {
+	const Event *x = a, *y = b;
+
+	if (x->at != y->at) {
+		return x->at < y->at ? -1 : 1;
+	}
+	return x->order - y->order;
+}
+
+/*
+ * The built-in week: 10% of charge every 15 hours down to 20% and two
+ * hours on the charger, a flaky connection on each morning's commute
+ * followed by twenty minutes out of range, and forty wrist flicks a day.
+ */
+static void script_week(void) {
+	uint32_t seed = 1;
+	int percent = 100;
+
+	add_event(0, EVENT_BATTERY, percent, false);
+	for (int32_t at = 15 * 3600; at < WEEK; at += 15 * 3600) {
+		percent -= 10;
+		add_event(at, EVENT_BATTERY, percent, false);
+		if (percent == 20) {
+			for (int step = 0; step < 4; step++) {
+				add_event(at + step * 1800, EVENT_BATTERY, percent + step * 20, true);
+			}
+			add_event(at + 2 * 3600, EVENT_BATTERY, 100, false);
+			at += 2 * 3600;
+			percent = 100;
+		}
+	}
+	for (int day = 0; day < 7; day++) {
+		// START is 19:30, so the first morning is 12.5 hours in
+		int32_t morning = day * DAY + 12 * 3600 + 1800;
+
+		for (int flip = 1; flip <= 6; flip++) {
+			add_event(morning + flip * 2, EVENT_BLUETOOTH, flip % 2 == 0, false);
+		}
+		add_event(morning + 20, EVENT_BLUETOOTH, false, false);
+		add_event(morning + 20 * 60, EVENT_BLUETOOTH, true, false);
+		for (int tap = 0; tap < 40; tap++) {
+			seed = seed * 1103515245 + 12345;
+			add_event(morning + (int32_t)((seed >> 8) % (14 * 3600)), EVENT_TAP, 0, false);
+		}
+	}
+	add_event(WEEK, EVENT_END, 0, false);
+}
+
+static bool load_trace(const char *path) {
+	FILE *f = fopen(path, "r");
+	char line[128], name[16], extra[16];
+	int at, value, line_number = 0;
+
+	if (!f) {
+		printf("%s: cannot open trace %s\n", REPLAY_NAME, path);
+		return false;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		int fields = sscanf(line, "%d %15s %d %15s", &at, name, &value, extra);
+
+		line_number++;
+		if (line[strspn(line, " \t\r\n")] == '#' || fields <= 0) {
+			continue;
+		}
+		if (fields >= 3 && !strcmp(name, "battery")) {
+			add_event(at, EVENT_BATTERY, value, fields == 4 && !strcmp(extra, "charging"));
+		} else if (fields == 3 && !strcmp(name, "bluetooth")) {
+			add_event(at, EVENT_BLUETOOTH, value != 0, false);
+		} else if (fields == 2 && !strcmp(name, "tap")) {
+			add_event(at, EVENT_TAP, 0, false);
+		} else if (fields == 2 && !strcmp(name, "end")) {
+			add_event(at, EVENT_END, 0, false);
+		} else {
+			printf("%s:%d: unknown event\n", path, line_number);
+			fclose(f);
+			return false;
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+// Play the events up to the first end, returning how many were played
+static int replay(void) {
+	qsort(s_events, s_event_count, sizeof(Event), compare_events);
+	for (int i = 0; i < s_event_count; i++) {
+		const Event *event = &s_events[i];
+
+		host_run_until(START + event->at);
+		switch (event->type) {
+		case EVENT_BATTERY:
+			host_set_battery((BatteryChargeState) {
+				.charge_percent = event->value,
+				.is_charging = event->plugged && event->value < 100,
+				.is_plugged = event->plugged,
+			});
+			break;
+		case EVENT_BLUETOOTH:
+			host_set_bluetooth(event->value);
+			break;
+		case EVENT_TAP:
+			host_accel_tap(ACCEL_AXIS_Y, 1);
+			break;
+		case EVENT_END:
+			return i + 1;
+		}
+		host_render_frame();
+	}
+	return s_event_count;
+}
+
+// The face's frame scheduler, see frame.h
+static void report_frames(uint32_t requests, uint32_t passes) {
+	printf("  frame scheduler  %llu requests, %llu render passes, %llu passes saved\n",
+		(unsigned long long)requests, (unsigned long long)passes,
+		(unsigned long long)(requests - passes));
+}
+
+static void report(const char *trace, int played, const HostStats *before) {
+	int32_t span = played ? s_events[played - 1].at : 0;
+	double total = 0;
+
+	printf("%s replay: %s, %d events over %.1f days\n", REPLAY_NAME, trace ? trace : "built-in week",
+		played, span / (double)DAY);
+	for (unsigned int i = 0; i < ARRAY_LENGTH(s_weights); i++) {
+		const EnergyWeight *w = &s_weights[i];
+		uint64_t count = *(const uint64_t *)((const char *)&host_stats + w->counter) -
+			*(const uint64_t *)((const char *)before + w->counter);
+		double charge = count * w->charge;
+
+		printf("  %-16s %12llu x %8.2f uAs = %8.3f mAh\n", w->name, (unsigned long long)count,
+			w->charge, charge / 3.6e6);
+		total += charge;
+	}
+	printf("  estimated charge %.3f mAh, %.2f%% of a %d mAh battery\n", total / 3.6e6,
+		total / 3.6e6 * 100 / BATTERY_MAH, BATTERY_MAH);
+}
+
+int main(int argc, char **argv) {
+	const char *trace = argc > 1 ? argv[1] : NULL;
+	HostStats before;
+	uint32_t requests, passes;
+	int played;
+
+	if (!trace) {
+		script_week();
+	} else if (!load_trace(trace)) {
+		return 1;
+	}
+	host_set_time(START);
+	init();
+	host_render_frame();
+	before = host_stats;
+	requests = frame_requests;
+	passes = frame_passes;
+	played = replay();
+	report(trace, played, &before);
+	report_frames(frame_requests - requests, frame_passes - passes);
+	deinit();
+	return 0;
+}
@@ -0,0 +1,123 @@
+#!/usr/bin/env python
+"""
+Generate the host equivalent of the SDK's resource_ids.auto.h.
+
+Reads a face's appinfo.json and writes resource_ids.auto.h (the
+RESOURCE_ID_* enum) and resources.auto.c (name, type, size and, for
+bitmaps, the PNG dimensions) into the given output directory. 1 bit
+grayscale PNGs also get their pixels, in the aplite GBitmap layout.
+"""
+
+import json
+import os
+import re
+import struct
+import sys
+import zlib
+
+
+def png_size(path):
+    with open(path, 'rb') as f:
+        header = f.read(24)
+    if header[:8] != b'\x89PNG\r\n\x1a\n':
+        return 0, 0
+    return struct.unpack('>II', header[16:24])
+
+
+def png_1bit_rows(path):
+    """Pixel rows of a non-interlaced 1 bit grayscale PNG, LSB first and
+    padded to 4 bytes like a GBitmap, or None for any other kind of PNG."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    at, idat, header = 8, b'', None
+    while at < len(data):
+        length, kind = struct.unpack('>I4s', data[at:at + 8])
+        body = data[at + 8:at + 8 + length]
+        if kind == b'IHDR':
+            header = struct.unpack('>IIBBBBB', body)
+        elif kind == b'IDAT':
+            idat += body
+        at += 12 + length
+    if not header or header[2:5] != (1, 0, 0) or header[6] != 0:
+        return None
+
+    width, height = header[:2]
+    stride = (width + 7) // 8
+    raw = zlib.decompress(idat)
+    rows, previous = [], bytearray(stride)
+    for y in range(height):
+        kind = raw[y * (stride + 1)]
+        row = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            left = row[i - 1] if i else 0
+            up = previous[i]
+            if kind == 1:
+                row[i] = (row[i] + left) & 0xff
+            elif kind == 2:
+                row[i] = (row[i] + up) & 0xff
+            elif kind == 3:
+                row[i] = (row[i] + (left + up) // 2) & 0xff
+            elif kind == 4:
+                upleft = previous[i - 1] if i else 0
+                p = left + up - upleft
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - upleft)
+                row[i] = (row[i] + (left if pa <= pb and pa <= pc else up if pb <= pc else upleft)) & 0xff
+        previous = row
+        out = bytearray(((width + 31) // 32) * 4)
+        for x in range(width):
+            if row[x // 8] & (0x80 >> (x % 8)):
+                out[x // 8] |= 1 << (x % 8)
+        rows.append(out)
+    return rows
+
+
+def font_height(name):
+    match = re.search(r'_(\d+)$', name)
+    return int(match.group(1)) if match else 14
+
+
+def main(project_dir, out_dir):
+    with open(os.path.join(project_dir, 'appinfo.json')) as f:
+        appinfo = json.load(f)
+    media = appinfo.get('resources', {}).get('media', [])
+
+    ids = []
+    entries = []
+    pixels = []
+    for res in media:
+        name = res['name']
+        path = os.path.join(project_dir, 'resources', res['file'])
+        width, height, font, data = 0, 0, 0, 'NULL'
+        if res['type'] in ('bitmap', 'png'):
+            width, height = png_size(path)
+            kind = 'HOST_RESOURCE_BITMAP'
+            rows = png_1bit_rows(path)
+            if rows:
+                data = 'pixels_%s' % name
+                pixels.append('static const uint8_t %s[] = {\n%s\n};\n' % (data, '\n'.join(
+                    '  ' + ' '.join('0x%02x,' % b for b in row) for row in rows)))
+        elif res['type'] == 'font':
+            font = font_height(name)
+            kind = 'HOST_RESOURCE_FONT'
+        else:
+            kind = 'HOST_RESOURCE_RAW'
+        ids.append('  RESOURCE_ID_%s,' % name)
+        entries.append('  { "%s", %s, %d, %d, %d, %d, %s },' % (
+            name, kind, os.path.getsize(path), width, height, font, data))
+
+    with open(os.path.join(out_dir, 'resource_ids.auto.h'), 'w') as f:
+        f.write('#pragma once\n\n')
+        f.write('typedef enum {\n  INVALID_RESOURCE = 0,\n  DEFAULT_MENU_ICON = 0,\n')
+        f.write('\n'.join(ids + ['  RESOURCE_ID_COUNT,']))
+        f.write('\n} ResourceId;\n')
+
+    with open(os.path.join(out_dir, 'resources.auto.c'), 'w') as f:
+        f.write('#include "pebble_host.h"\n\n')
+        f.write(''.join(p + '\n' for p in pixels))
+        f.write('const struct HostResource host_resources[] = {\n')
+        f.write('\n'.join(entries + ['  { NULL, HOST_RESOURCE_RAW, 0, 0, 0, 0, NULL },']))
+        f.write('\n};\n')
+
+
+if __name__ == '__main__':
+    main(sys.argv[1], sys.argv[2])
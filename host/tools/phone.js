@@ -0,0 +1,161 @@
+#!/usr/bin/env node
+/*
+ * Local stand-in for the phone side of calendar_face: runs its PebbleKit JS
+ * companion, calendar_face/src/js/app.js, against a calendar file and
+ * prints the AppMessages it sends to the watch, acking each.
+ *
+ *     phone.js --ics FILE --state FILE --now MS [--inbox MESSAGE]
+ *
+ * A run is one wake of the companion at --now (ms since 1970): 'ready'
+ * fires, then 'appmessage' with the watch's --inbox message if given.
+ * --state keeps localStorage from one run to the next. Messages are their
+ * tuples as KEY=VALUE with the appKeys numbers as keys, "i" before an
+ * integer and "b" before comma separated bytes, one message per line:
+ *
+ *     send 0=i16976 1=b3,1,10,2 2=i1
+ */
+'use strict';
+
+var fs = require('fs');
+var path = require('path');
+var vm = require('vm');
+
+var FACE = path.join(__dirname, '..', '..', 'calendar_face');
+
+function usage() {
+  console.error('usage: phone.js --ics FILE --state FILE --now MS [--inbox MESSAGE]');
+  process.exit(2);
+}
+
+function parseArgs(argv) {
+  var args = {};
+
+  for (var i = 0; i < argv.length; i += 2) {
+    if (!/^--(ics|state|now|inbox)$/.test(argv[i]) || i + 1 >= argv.length) {
+      usage();
+    }
+    args[argv[i].slice(2)] = argv[i + 1];
+  }
+  if (!args.ics || !args.state || !args.now) {
+    usage();
+  }
+  return args;
+}
+
+function encodeMessage(message, keys) {
+  return Object.keys(message).map(function(name) {
+    var value = message[name];
+
+    if (!(name in keys)) {
+      throw new Error('no appKey ' + name);
+    }
+    if (Array.isArray(value)) {
+      return keys[name] + '=b' + value.join(',');
+    }
+    return keys[name] + '=i' + (value | 0);
+  }).join(' ');
+}
+
+function decodeMessage(text, keys) {
+  var payload = {};
+
+  text.split(/\s+/).filter(Boolean).forEach(function(tuple) {
+    var m = /^(\d+)=([ib])(.*)$/.exec(tuple);
+    if (!m) {
+      usage();
+    }
+    var value = m[2] === 'i' ? +m[3] : m[3].split(',').map(Number);
+    payload[m[1]] = value;
+    Object.keys(keys).forEach(function(name) {
+      if (keys[name] === +m[1]) {
+        payload[name] = value;
+      }
+    });
+  });
+  return payload;
+}
+
+function main() {
+  var args = parseArgs(process.argv.slice(2));
+  var keys = JSON.parse(fs.readFileSync(path.join(FACE, 'appinfo.json'))).appKeys;
+  var now = +args.now;
+  var store = fs.existsSync(args.state) ? JSON.parse(fs.readFileSync(args.state)) : {};
+  var listeners = {};
+
+  store.icsUrl = 'file://' + path.resolve(args.ics);
+
+  class FakeDate extends Date {
+    constructor() {
+      if (arguments.length) {
+        super(...arguments);
+      } else {
+        super(now);
+      }
+    }
+
+    static now() {
+      return now;
+    }
+  }
+
+  function XMLHttpRequest() {
+  }
+  XMLHttpRequest.prototype.open = function(method, url) {
+    this.url = url;
+  };
+  XMLHttpRequest.prototype.send = function() {
+    var req = this;
+
+    setImmediate(function() {
+      try {
+        req.responseText = fs.readFileSync(req.url.replace(/^file:\/\//, ''), 'utf8');
+        req.status = 200;
+      } catch (e) {
+        req.responseText = '';
+        req.status = 404;
+      }
+      req.onload();
+    });
+  };
+
+  var sandbox = {
+    Date: FakeDate,
+    XMLHttpRequest: XMLHttpRequest,
+    console: console,
+    // One wake only, the next run stands for the next interval
+    setInterval: function() { return 0; },
+    setTimeout: function(callback) { return setImmediate(callback); },
+    localStorage: {
+      getItem: function(key) { return key in store ? store[key] : null; },
+      setItem: function(key, value) { store[key] = String(value); },
+      removeItem: function(key) { delete store[key]; },
+    },
+    Pebble: {
+      addEventListener: function(type, callback) {
+        (listeners[type] = listeners[type] || []).push(callback);
+      },
+      sendAppMessage: function(message, ack, nack) {
+        console.log('send ' + encodeMessage(message, keys));
+        setImmediate(ack, { data: message });
+      },
+      openURL: function() {
+      },
+    },
+  };
+
+  function fire(type, e) {
+    (listeners[type] || []).forEach(function(callback) { callback(e); });
+  }
+
+  var source = path.join(FACE, 'src', 'js', 'app.js');
+  vm.runInNewContext(fs.readFileSync(source, 'utf8'), sandbox, { filename: source });
+  process.on('exit', function() {
+    fs.writeFileSync(args.state, JSON.stringify(store));
+  });
+  fire('ready', {});
+  if (args.inbox) {
+    fire('appmessage', { payload: decodeMessage(args.inbox, keys) });
+  }
+}
+
+main();
@@ -0,0 +1,78 @@
+/*
+ * Runs calendar_face down to empty and charges it up again a percent at a
+ * time. After every change the screen must show the dots of the charge
+ * level, including the changes the face did not repaint for, and the face
+ * must repaint exactly when the count of filled dots changes.
+ */
+#include "host.h"
+
+#define main calendar_face_main
+#include "../calendar_face/src/main.c"
+#undef main
+
+#define START 1466796600 // 2016-06-24 19:30:00 UTC
+#define FB_BYTES (HOST_SCREEN_HEIGHT * HOST_FB_BYTES_PER_ROW)
+
+static int s_failures;
+
+static void fail(int percent, const char *what) {
+	if (s_failures++ < 20) {
+		printf("  %d%%: %s\n", percent, what);
+	}
+}
+
+static GContext *clear_battery_layer(void) {
+	GContext *ctx = host_layer_context(battery_layer);
+
+	graphics_context_set_fill_color(ctx, GColorBlack);
+	graphics_fill_rect(ctx, layer_get_bounds(battery_layer), 0, GCornerNone);
+	return ctx;
+}
+
+// The frame buffer with a fresh paint of the dots of percent
+static void draw_expected(uint8_t percent, uint8_t *out) {
+	uint8_t shown = battery_dots;
+
+	battery_dots = percent / 10;
+	battery_layer_update_callback(battery_layer, clear_battery_layer());
+	battery_dots = shown;
+	memcpy(out, gbitmap_get_data(host_framebuffer()), FB_BYTES);
+}
+
+int main(void) {
+	uint8_t expected[FB_BYTES], screen[FB_BYTES];
+	int events = 0, repaints = 0, level_changes = 0;
+
+	host_set_time(START);
+	host_set_battery((BatteryChargeState) { .charge_percent = 100 });
+	init();
+	host_render_frame();
+	host_run_until(START + 1);
+
+	// Down to empty and back on the charger, through the face's handler
+	for (int step = 1; step <= 200; step++) {
+		uint8_t percent = step <= 100 ? 100 - step : step - 100;
+		uint8_t shown = battery_dots;
+
+		host_set_battery((BatteryChargeState) { .charge_percent = percent, .is_plugged = step > 100 });
+		events++;
+		level_changes += percent / 10 != shown;
+		// The dots change in the face's next frame pass, rendering runs it
+		host_render_frame();
+		repaints += battery_dots != shown;
+		memcpy(screen, gbitmap_get_data(host_framebuffer()), FB_BYTES);
+		draw_expected(percent, expected);
+		if (memcmp(expected, screen, FB_BYTES)) {
+			fail(percent, "screen does not show the charge level");
+		}
+	}
+	deinit();
+	if (repaints != level_changes) {
+		printf("  %d battery repaints for %d dot level changes\n", repaints, level_changes);
+		s_failures++;
+	}
+
+	printf("  %d charge events, %d battery repaints\n", events, repaints);
+	printf("battery dots: %s (%d failures)\n", s_failures ? "FAIL" : "ok", s_failures);
+	return s_failures ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+/*
+ * Checks calendar_face's calendar engine on every day of a 400 year
+ * Gregorian cycle, 2000 to 2399, in both views and with both week starts.
+ * Each grid built from scratch is compared with one worked out the long
+ * way from a day by day walk of the calendar and libc's ISO weeks, and
+ * with the grid moved there a day at a time by calendar_set_today(). The
+ * Sunday two week grid also has to match the get_calendar() it replaced.
+ */
+#include "pebble.h"
+#include "../calendar_face/src/calendar.h"
+#include "legacy_calendar.h"
+
+#define CYCLE_DAYS 146097
+#define MARGIN 42                   // days of grid outside the cycle
+#define FIRST_DAY 10957             // 2000-01-01
+
+// The reference calendar, a day at a time from MARGIN days before 2000
+typedef struct {
+	int16_t year;
+	uint8_t month;
+	uint8_t mday;
+	uint8_t wday;
+	uint8_t iso_week;
+	int16_t yday;
+} RefDay;
+
+static RefDay s_ref[CYCLE_DAYS + 2 * MARGIN];
+static int s_failures;
+
+static const RefDay *ref(int32_t day) {
+	return &s_ref[day - FIRST_DAY + MARGIN];
+}
+
+static int ref_month_length(int year, int month) {
+	if (month == 1) {
+		return year % 400 == 0 || (year % 4 == 0 && year % 100 != 0) ? 29 : 28;
+	}
+	return 31 - month % 7 % 2;
+}
+
+// From 1999-11-20, MARGIN days before 2000 and a Saturday like 2000-01-01
+static void build_reference(void) {
+	int year = 1999, month = 10, mday = 20, yday = 323, wday = 6;
+
+	for (int i = 0; i < CYCLE_DAYS + 2 * MARGIN; i++) {
+		RefDay *d = &s_ref[i];
+		struct tm t = {
+			.tm_year = year - 1900, .tm_mon = month, .tm_mday = mday,
+			.tm_wday = wday, .tm_yday = yday,
+		};
+		char week[4];
+
+		strftime(week, sizeof(week), "%V", &t);
+		*d = (RefDay) { year, month, mday, wday, atoi(week), yday };
+		wday = (wday + 1) % 7;
+		yday++;
+		if (++mday > ref_month_length(year, month)) {
+			mday = 1;
+			if (++month == 12) {
+				month = 0;
+				year++;
+				yday = 0;
+			}
+		}
+	}
+}
+
+static void fail(int32_t day, const char *layout, const char *what) {
+	const RefDay *d = ref(day);
+
+	if (s_failures++ < 20) {
+		printf("  %04d-%02d-%02d %s: %s\n", d->year, d->month + 1, d->mday, layout, what);
+	}
+}
+
+// The grid for today, worked out from the reference
+static void check_grid(const CalendarGrid *grid, int32_t today, const char *layout) {
+	const RefDay *d = ref(today);
+	int32_t first_day;
+	int weeks;
+
+	if (grid->view == CALENDAR_TWO_WEEKS) {
+		first_day = today - (d->wday + 7 - grid->week_start) % 7;
+		weeks = 2;
+	} else {
+		int32_t first = today - (d->mday - 1);
+		first_day = first - (ref(first)->wday + 7 - grid->week_start) % 7;
+		weeks = (first - first_day + ref_month_length(d->year, d->month) + 6) / 7;
+	}
+	if (grid->today != today || grid->first_day != first_day || grid->weeks != weeks) {
+		fail(today, layout, "wrong span");
+		return;
+	}
+	for (int i = 0; i < weeks * 7; i++) {
+		if (grid->mday[i] != ref(first_day + i)->mday) {
+			fail(today, layout, "wrong day of month");
+			return;
+		}
+	}
+	for (int r = 0; r < weeks; r++) {
+		if (grid->iso_week[r] != ref(first_day + r * 7 + !grid->week_start)->iso_week) {
+			fail(today, layout, "wrong ISO week");
+			return;
+		}
+	}
+}
+
+static bool same_grid(const CalendarGrid *a, const CalendarGrid *b) {
+	return a->today == b->today && a->first_day == b->first_day && a->weeks == b->weeks &&
+		!memcmp(a->mday, b->mday, a->weeks * 7) && !memcmp(a->iso_week, b->iso_week, a->weeks);
+}
+
+int main(void) {
+	static const char *layouts[2][2] = {
+		{ "two weeks from Sunday", "two weeks from Monday" },
+		{ "month from Sunday", "month from Monday" },
+	};
+	CalendarGrid moved[2][2];
+	int checked = 0;
+
+	build_reference();
+	for (int32_t day = FIRST_DAY; day < FIRST_DAY + CYCLE_DAYS; day++) {
+		const RefDay *d = ref(day);
+		struct tm t = {
+			.tm_year = d->year - 1900, .tm_mon = d->month, .tm_mday = d->mday,
+			.tm_wday = d->wday, .tm_yday = d->yday,
+		};
+		int year, month, mday, legacy[14];
+		CalendarGrid grid;
+
+		calendar_civil(day, &year, &month, &mday);
+		if (calendar_day_number(&t) != day || year != d->year || month != d->month ||
+			mday != d->mday || calendar_weekday(day) != d->wday) {
+			fail(day, "date", "day number does not round trip");
+		}
+		for (int view = 0; view < 2; view++) {
+			for (int week_start = 0; week_start < 2; week_start++) {
+				CalendarGrid fresh;
+
+				calendar_build(&fresh, view, week_start, day);
+				check_grid(&fresh, day, layouts[view][week_start]);
+				if (day == FIRST_DAY) {
+					moved[view][week_start] = fresh;
+				} else {
+					calendar_set_today(&moved[view][week_start], day);
+					if (!same_grid(&moved[view][week_start], &fresh)) {
+						fail(day, layouts[view][week_start], "moved grid differs from a fresh one");
+					}
+				}
+				checked++;
+			}
+		}
+
+		legacy_get_calendar(legacy, &t);
+		calendar_build(&grid, CALENDAR_TWO_WEEKS, 0, day);
+		for (int i = 0; i < 14; i++) {
+			if (legacy[i] != grid.mday[i]) {
+				fail(day, "get_calendar", "differs");
+				break;
+			}
+		}
+	}
+
+	printf("calendar: %s (%d days, %d grids, %d failures)\n", s_failures ? "FAIL" : "ok",
+		CYCLE_DAYS, checked, s_failures);
+	return s_failures ? 1 : 0;
+}
@@ -0,0 +1,286 @@
+/*
+ * Syncs calendar_face's event markers from its phone companion through two
+ * weeks of a changing calendar and checks the counts the watch draws
+ * against the calendar after every sync. The phone side is the real
+ * src/js/app.js, run once per sync by tools/phone.js under $NODE; without
+ * node the check is skipped. Then the watch restarts, once with its markers
+ * in storage and once without them and with its first request lost.
+ */
+#include "host.h"
+
+#define main calendar_face_main
+#include "../calendar_face/src/main.c"
+#undef main
+
+#define START 1466796600 // 2016-06-24 19:30:00 UTC
+#define HOUR 3600
+#define DAY (24 * HOUR)
+#define SYNC_HOURS 6     // SYNC_INTERVAL_MS in app.js
+#define SYNC_DAYS 14
+
+#define ICS_PATH SYNC_DIR "/calendar_sync.ics"
+#define STATE_PATH SYNC_DIR "/calendar_sync.json"
+
+// An event on the phone's calendar, in seconds from START
+typedef struct {
+	int32_t at;
+	int32_t added;
+	int32_t removed;    // 0 if it stays
+} CalendarEvent;
+
+#define MAX_EVENTS 64
+
+static CalendarEvent s_events[MAX_EVENTS];
+static int s_event_count;
+static const char *s_node;
+static int s_failures;
+
+typedef struct {
+	int syncs;
+	int batches;            // messages from the phone
+	int requests;           // messages from the watch
+	int max_round_trips;    // in one sync
+	int delta_bytes;
+} SyncStats;
+
+static SyncStats s_stats;
+
+static void fail(time_t now, const char *what) {
+	printf("  +%.2fd: %s\n", (now - START) / (double)DAY, what);
+	s_failures++;
+}
+
+static void add_event(int32_t at, int32_t added, int32_t removed) {
+	if (s_event_count < MAX_EVENTS) {
+		s_events[s_event_count++] = (CalendarEvent) { at, added, removed };
+	}
+}
+
+/*
+ * Events from three days back to four weeks ahead, each added up to ten
+ * days before it starts and one in six deleted again a few days later,
+ * and a busy day with more events than the watch draws dots.
+ */
+static void script_calendar(void) {
+	uint32_t seed = 7;
+
+	for (int i = 0; i < 48; i++) {
+		int32_t at, added;
+
+		seed = seed * 1103515245 + 12345;
+		at = ((int32_t)(seed >> 8) % 27 - 3) * DAY + (8 + (int32_t)(seed >> 20) % 12) * HOUR;
+		seed = seed * 1103515245 + 12345;
+		added = at - (int32_t)((seed >> 8) % (10 * DAY));
+		add_event(at, added, i % 6 == 5 ? added + (int32_t)((seed >> 4) % (4 * DAY)) + HOUR : 0);
+	}
+	for (int i = 0; i < 5; i++) {
+		add_event(3 * DAY + (9 + i) * HOUR, -DAY, 0);
+	}
+}
+
+static bool event_visible(const CalendarEvent *event, time_t now) {
+	int32_t t = (int32_t)(now - START);
+
+	return event->added <= t && (!event->removed || event->removed > t);
+}
+
+static bool write_ics(time_t now) {
+	FILE *f = fopen(ICS_PATH, "w");
+
+	if (!f) {
+		return false;
+	}
+	fprintf(f, "BEGIN:VCALENDAR\r\nVERSION:2.0\r\n");
+	for (int i = 0; i < s_event_count; i++) {
+		time_t at = START + s_events[i].at;
+		char start[20];
+
+		if (event_visible(&s_events[i], now)) {
+			strftime(start, sizeof(start), "%Y%m%dT%H%M%SZ", gmtime(&at));
+			fprintf(f, "BEGIN:VEVENT\r\nUID:%d@host\r\nDTSTART:%s\r\nSUMMARY:Event %d\r\nEND:VEVENT\r\n",
+				i, start, i);
+		}
+	}
+	fprintf(f, "END:VCALENDAR\r\n");
+	fclose(f);
+	return true;
+}
+
+// A dictionary in phone.js's KEY=VALUE form
+static void format_message(const uint8_t *buffer, uint16_t size, char *text, size_t text_size) {
+	DictionaryIterator iterator;
+	size_t used = 0;
+
+	text[0] = '\0';
+	for (Tuple *t = dict_read_begin_from_buffer(&iterator, buffer, size); t; t = dict_read_next(&iterator)) {
+		int32_t value = t->length == 1 ? t->value->uint8 : t->value->int32;
+
+		if (t->type == TUPLE_BYTE_ARRAY) {
+			continue;
+		}
+		used += snprintf(text + used, text_size - used, "%s%u=i%d", used ? " " : "", (unsigned)t->key, (int)value);
+	}
+}
+
+static uint16_t parse_message(char *line, uint8_t *buffer, uint16_t size) {
+	DictionaryIterator iterator;
+
+	dict_write_begin(&iterator, buffer, size);
+	for (char *tuple = strtok(line, " \n"); tuple; tuple = strtok(NULL, " \n")) {
+		char *value;
+		uint32_t key = strtoul(tuple, &value, 10);
+
+		if (value[0] != '=') {
+			return 0;
+		}
+		if (value[1] == 'i') {
+			dict_write_int32(&iterator, key, (int32_t)strtol(value + 2, NULL, 10));
+		} else if (value[1] == 'b') {
+			uint8_t bytes[64];
+			uint16_t count = 0;
+
+			for (char *p = value + 2; *p && count < sizeof(bytes); p += *p == ',') {
+				bytes[count++] = (uint8_t)strtoul(p, &p, 10);
+			}
+			dict_write_data(&iterator, key, bytes, count);
+			s_stats.delta_bytes += count;
+		}
+	}
+	return (uint16_t)dict_write_end(&iterator);
+}
+
+// One wake of the companion at now, with what the watch sent since the last
+static void sync(time_t now) {
+	char inbox[64], command[512], line[256];
+	uint8_t buffer[256];
+	uint16_t size = host_app_message_take(buffer, sizeof(buffer));
+	int round_trips = 0;
+	FILE *phone;
+
+	if (!write_ics(now)) {
+		fail(now, "cannot write " ICS_PATH);
+		return;
+	}
+	inbox[0] = '\0';
+	if (size) {
+		DictionaryIterator request;
+		Tuple *week_start;
+
+		dict_read_begin_from_buffer(&request, buffer, size);
+		week_start = dict_find(&request, KEY_EVENT_WEEK_START);
+		if (!week_start || week_start->value->uint8 != CALENDAR_WEEK_START) {
+			fail(now, "request without the week start");
+		}
+		format_message(buffer, size, inbox, sizeof(inbox));
+		s_stats.requests++;
+		round_trips++;
+	}
+	snprintf(command, sizeof(command), "%s tools/phone.js --ics %s --state %s --now %lld%s%s%s",
+		s_node, ICS_PATH, STATE_PATH, (long long)now * 1000,
+		size ? " --inbox '" : "", inbox, size ? "'" : "");
+	phone = popen(command, "r");
+	if (!phone) {
+		fail(now, "cannot run tools/phone.js");
+		return;
+	}
+	while (fgets(line, sizeof(line), phone)) {
+		if (strncmp(line, "send ", 5)) {
+			continue;
+		}
+		size = parse_message(line + 5, buffer, sizeof(buffer));
+		if (!size || !host_app_message_receive(buffer, size)) {
+			fail(now, "message dropped");
+		}
+		s_stats.batches++;
+		round_trips++;
+	}
+	if (pclose(phone)) {
+		fail(now, "tools/phone.js failed");
+	}
+	s_stats.syncs++;
+	if (round_trips > s_stats.max_round_trips) {
+		s_stats.max_round_trips = round_trips;
+	}
+}
+
+// The dots under each day of the strip against the calendar itself
+static void check_markers(time_t now) {
+	for (int i = 0; i < EVENT_DAYS; i++) {
+		int32_t day = calendar.first_day + i;
+		int32_t index = day - events.day;
+		int shown = index >= 0 && index < EVENT_DAYS ? events.count[index] : 0;
+		int expected = 0;
+
+		for (int e = 0; e < s_event_count; e++) {
+			if (event_visible(&s_events[e], now) && (START + s_events[e].at) / DAY == day) {
+				expected++;
+			}
+		}
+		if (shown != (expected < EVENT_MAX ? expected : EVENT_MAX)) {
+			char what[64];
+			snprintf(what, sizeof(what), "day %d shows %d events, calendar has %d", i, shown, expected);
+			fail(now, what);
+		}
+	}
+}
+
+int main(void) {
+	char command[256];
+	time_t now = START + 1;
+
+	s_node = getenv("NODE") ? getenv("NODE") : "node";
+	snprintf(command, sizeof(command), "%s --version >/dev/null 2>&1", s_node);
+	if (system(command) != 0) {
+		printf("calendar sync: skipped, no node (set NODE)\n");
+		return 0;
+	}
+	remove(STATE_PATH);
+	script_calendar();
+
+	host_set_time(START);
+	init();
+	host_render_frame();
+	for (int i = 0; i <= SYNC_DAYS * 24 / SYNC_HOURS; i++, now += SYNC_HOURS * HOUR) {
+		host_run_until(now);
+		sync(now);
+		check_markers(now);
+	}
+	deinit();
+
+	// A restart takes the markers from storage and asks for nothing
+	memset(&events, 0, sizeof(events));
+	init();
+	host_render_frame();
+	host_run_until(now);
+	if (host_app_message_take((uint8_t[16]) { 0 }, 16)) {
+		fail(now, "restart asked for a full sync");
+	}
+	check_markers(now);
+	deinit();
+
+	// A watch that lost its markers while the phone still diffs against
+	// what it last sent. The request is lost, the phone's own sync has
+	// nothing the watch can use, and the retry gets a full sync.
+	memset(&events, 0, sizeof(events));
+	persist_delete(STORAGE_PKEY);
+	init();
+	host_render_frame();
+	host_run_pending();
+	if (!host_app_message_fail(APP_MSG_SEND_TIMEOUT)) {
+		fail(now, "no request from a watch without markers");
+	}
+	sync(now);
+	now += EVENT_RETRY_MS / 1000;
+	host_run_until(now);
+	sync(now);
+	check_markers(now);
+	deinit();
+
+	printf("  %d syncs over %d days: %d batches, %d watch requests, at most %d round-trips per sync\n",
+		s_stats.syncs, SYNC_DAYS, s_stats.batches, s_stats.requests, s_stats.max_round_trips);
+	printf("  %.1f radio wakes a day, %.1f delta bytes per batch\n",
+		(s_stats.batches + s_stats.requests) / (double)SYNC_DAYS,
+		s_stats.batches ? s_stats.delta_bytes / (double)s_stats.batches : 0.0);
+	printf("calendar sync: %s (%d failures)\n", s_failures ? "FAIL" : "ok", s_failures);
+	return s_failures ? 1 : 0;
+}
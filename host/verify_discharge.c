@@ -0,0 +1,177 @@
+/*
+ * Replays battery curves through calendar_face's discharge estimator and
+ * checks its running sums against a fit from scratch and its predicted
+ * empty time against the one the curve really reaches.
+ */
+#include "host.h"
+
+#define main calendar_face_main
+#include "../calendar_face/src/main.c"
+#undef main
+
+#define START 1466796600 // 2016-06-24 19:30:00 UTC
+
+// A curve as the watch reports it: the charge level after each change
+typedef struct {
+	const char *name;
+	int hours[40];
+	uint8_t percent[40];
+	int count;
+	int empty_hours;        // when the curve reaches 0%
+	int tolerance_percent;  // allowed error of the remaining time
+	int tolerance_hours;    // or this many hours, whichever is more
+} Curve;
+
+static const Curve s_curves[] = {
+	{
+		// A week on a charge, in the 10% steps aplite reports
+		"steady week",
+		{ 0, 17, 34, 50, 67, 84, 101, 118, 134, 151 },
+		{ 100, 90, 80, 70, 60, 50, 40, 30, 20, 10 },
+		10, 168, 5, 0,
+	},
+	{
+		// Uneven steps: notifications in the day, idle at night
+		"day and night",
+		{ 0, 10, 28, 38, 57, 66, 85, 94, 113, 122 },
+		{ 100, 90, 80, 70, 60, 50, 40, 30, 20, 10 },
+		10, 136, 15, 0,
+	},
+	{
+		// Shaped like a Li-ion cell: the first 10% go quickly, the middle is
+		// flat and the last 20% fall off the knee of the voltage curve. A
+		// straight line is a day early while the quick first 10% is in the fit
+		// and a day late at the knee, which it can't see coming.
+		"li-ion knee",
+		{ 0, 5, 22, 41, 60, 79, 98, 115, 128, 137 },
+		{ 100, 90, 80, 70, 60, 50, 40, 30, 20, 10 },
+		10, 143, 15, 26,
+	},
+	{
+		// Longer than the ring, so the oldest samples drop out
+		"slow month",
+		{ 0, 24, 48, 72, 96, 120, 144, 168, 192, 216, 240, 264, 288, 312, 336,
+		  360, 384, 408, 432, 456, 480, 504, 528, 552, 576, 600, 624, 648, 672, 696 },
+		{ 100, 97, 93, 90, 87, 83, 80, 77, 73, 70, 67, 63, 60, 57, 53,
+		  50, 47, 43, 40, 37, 33, 30, 27, 23, 20, 17, 13, 10, 7, 3 },
+		30, 720, 5, 0,
+	},
+};
+
+static int s_failures;
+
+static void fail(const char *curve, int sample, const char *what) {
+	printf("  %s[%d]: %s\n", curve, sample, what);
+	s_failures++;
+}
+
+// The running sums must match the ring they summarize
+static void check_sums(const char *curve, int sample, const DischargeEstimator *e) {
+	int32_t sum_t = 0, sum_c = 0;
+	int64_t sum_tt = 0, sum_tc = 0;
+
+	for (int i = 0; i < e->count; i++) {
+		sum_t += e->minute[i];
+		sum_c += e->percent[i];
+		sum_tt += (int64_t)e->minute[i] * e->minute[i];
+		sum_tc += (int64_t)e->minute[i] * e->percent[i];
+	}
+	if (sum_t != e->sum_t || sum_c != e->sum_c || sum_tt != e->sum_tt || sum_tc != e->sum_tc) {
+		fail(curve, sample, "running sums differ from the ring");
+	}
+}
+
+static void replay(const Curve *curve) {
+	DischargeEstimator e;
+	int worst = 0, worst_hours = 0;
+
+	discharge_reset(&e);
+	for (int i = 0; i < curve->count; i++) {
+		time_t now = START + (time_t)curve->hours[i] * 3600;
+		time_t empty;
+
+		discharge_add(&e, now, curve->percent[i]);
+		check_sums(curve->name, i, &e);
+		if (discharge_empty_at(&e, &empty) != (i > 0)) {
+			fail(curve->name, i, i ? "no estimate on a falling curve" : "estimate from one sample");
+			continue;
+		}
+		// Judge the estimate once a few steps are in
+		if (i >= 2) {
+			int remaining = curve->empty_hours - curve->hours[i];
+			int hours = abs((int)((empty - now) / 3600) - remaining);
+			int error = hours * 100 / remaining;
+			if (error > curve->tolerance_percent && hours > curve->tolerance_hours) {
+				fail(curve->name, i, "remaining time off by more than the tolerance");
+			}
+			if (error > worst) {
+				worst = error;
+			}
+			if (hours > worst_hours) {
+				worst_hours = hours;
+			}
+		}
+	}
+	printf("  %-14s %2d samples, remaining time within %d%%, %d hours\n",
+		curve->name, curve->count, worst, worst_hours);
+}
+
+// Through the face: a plug resets the estimate and the text shows it.
+// Samples are kept in RAM, only plug edges and the exit write them.
+static void check_face(void) {
+	BatteryChargeState state = { .charge_percent = 100 };
+	uint64_t writes;
+	Storage stored;
+	time_t now = START + 4 * 17 * 3600;
+
+	host_set_time(START);
+	init();
+	host_render_frame();
+	host_run_until(START + 1);
+	writes = host_stats.persist_writes;
+	host_set_battery(state);
+	for (int i = 1; i <= 3; i++) {
+		host_advance_time(START + (time_t)i * 17 * 3600);
+		state.charge_percent = 100 - 10 * i;
+		host_set_battery(state);
+	}
+	host_run_pending();
+	if (text_layer_get_text(battery_duration_layer)[0] != 'R') {
+		fail("face", 3, "no remaining time shown while discharging");
+	}
+	if (host_stats.persist_writes != writes) {
+		fail("face", 3, "discharge samples written before a plug edge");
+	}
+
+	state.is_plugged = true;
+	host_set_battery(state);
+	state.is_plugged = false;
+	host_set_battery(state);
+	host_run_pending();
+	if (discharge.count != 1 || text_layer_get_text(battery_duration_layer)[0] == 'R') {
+		fail("face", 4, "estimate survived a charge");
+	}
+
+	host_run_until(now);
+	state.charge_percent = 60;
+	host_set_battery(state);
+	deinit();
+	if (persist_read_data(STORAGE_PKEY, &stored, sizeof(stored)) != sizeof(stored) ||
+		stored.discharge.count != 2) {
+		fail("face", 5, "samples since the last plug edge lost on exit");
+	}
+}
+
+int main(void) {
+	if (sizeof(DischargeEstimator) > 100) {
+		fail("state", 0, "estimator is over 100 bytes");
+	}
+	for (unsigned int i = 0; i < ARRAY_LENGTH(s_curves); i++) {
+		replay(&s_curves[i]);
+	}
+	check_face();
+
+	printf("discharge: %s (%d failures, %u bytes of state)\n", s_failures ? "FAIL" : "ok",
+		s_failures, (unsigned)sizeof(DischargeEstimator));
+	return s_failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Checks the generated thins hand tables against the sin_lookup/cos_lookup
+ * math they replaced, for every minute, hour position, second and marker.
+ * The host's sin_lookup() folds a quarter wave table like the firmware's,
+ * not the full circle formula tools/gen_hand_tables.py evaluates, so the
+ * two sides don't share their rounding. The Makefile builds it once for
+ * aplite's tables and once with HOST_PLATFORM_CHALK for chalk's.
+ */
+#include "host.h"
+
+#define main thins_main
+#include "../thins/src/main.c"
+#undef main
+
+#ifndef VERIFY_NAME
+#define VERIFY_NAME "hand tables"
+#endif
+
+static int s_failures;
+
+static GPoint runtime_hand_point(int quantity, int intervals, int len, GPoint center) {
+	return (GPoint) {
+		.x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * quantity / intervals) * (int32_t)len / TRIG_MAX_RATIO) + center.x,
+		.y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * quantity / intervals) * (int32_t)len / TRIG_MAX_RATIO) + center.y,
+	};
+}
+
+static GPoint runtime_hour_point(int hours, int minutes, GPoint center) {
+	int32_t hour_angle = TRIG_MAX_ANGLE * ((hours % 12) * 60 + minutes) / (12 * 60);
+
+	return (GPoint) {
+		.x = (int16_t)(sin_lookup(hour_angle) * (int32_t)HAND_LENGTH_HOUR / TRIG_MAX_RATIO) + center.x,
+		.y = (int16_t)(-cos_lookup(hour_angle) * (int32_t)HAND_LENGTH_HOUR / TRIG_MAX_RATIO) + center.y,
+	};
+}
+
+static GPoint runtime_marker_point(int bucket, int h, GPoint center) {
+	return (GPoint) {
+		.x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * bucket / 12 + TRIG_MAX_ANGLE * h / 60) *
+				(int32_t)SPOKE_LENGTH / TRIG_MAX_RATIO) + center.x,
+		.y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * bucket / 12 + TRIG_MAX_ANGLE * h / 60) *
+				(int32_t)SPOKE_LENGTH / TRIG_MAX_RATIO) + center.y,
+	};
+}
+
+static void expect(const char *what, int index, GPoint table, GPoint runtime) {
+	if (!gpoint_equal(&table, &runtime)) {
+		printf("  %s[%d]: table (%d, %d) != runtime (%d, %d)\n",
+			what, index, table.x, table.y, runtime.x, runtime.y);
+		s_failures++;
+	}
+}
+
+int main(void) {
+	GRect screen = GRect(0, 0, HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT);
+	GPoint center = grect_center_point(&screen);
+
+	expect("center", 0, GPoint(LAYOUT_CENTER_X, LAYOUT_CENTER_Y), center);
+	for (int m = 0; m < 60; m++) {
+		expect("minute", m, hand_point(s_minute_tips, m), runtime_hand_point(m, 60, HAND_LENGTH_MIN, center));
+		expect("second", m, hand_point(s_second_tips, m), runtime_hand_point(m, 60, HAND_LENGTH_SEC, center));
+		expect("tail", m, hand_point(s_second_tails, m), runtime_hand_point(m, 60, -HAND_LENGTH_SEC_TAIL, center));
+		expect("marker", m, s_marker_tips[m], runtime_marker_point(m / 5, m % 5, center));
+	}
+	for (int h = 0; h < 24; h++) {
+		for (int m = 0; m < 60; m++) {
+			expect("hour", h * 60 + m, hand_point(s_hour_tips, (h % 12) * 60 + m), runtime_hour_point(h, m, center));
+		}
+	}
+
+	// Const data is loaded with the code, into the 24 KB aplite shares with the heap
+	printf(VERIFY_NAME ": %s (%d mismatches, %u bytes)\n", s_failures ? "FAIL" : "ok", s_failures,
+		(unsigned)(sizeof(s_minute_tips) + sizeof(s_hour_tips) + sizeof(s_second_tips) +
+			sizeof(s_second_tails) + sizeof(s_marker_tips)));
+	return s_failures ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * Bluetooth debouncing. A connection change is only acted on once it held
+ * for BLUETOOTH_SETTLE_MS, so a flapping connection neither repaints nor
+ * vibrates until it makes up its mind. bluetooth_start() takes the
+ * connection as it is and subscribes; each change that held then sets
+ * bluetooth_connected and calls the face's bluetooth_changed().
+ *
+ * bluetooth_flaps counts the changes undone before they settled. Repeated
+ * reports of the same state are neither flaps nor a reason to wait longer.
+ */
+#pragma once
+
+#define BLUETOOTH_SETTLE_MS 5000
+
+// The face's, bluetooth_connected changed and held
+static void bluetooth_changed(void);
+
+static bool bluetooth_connected = false;
+static AppTimer *bluetooth_timer;
+static bool bluetooth_pending;
+static uint32_t bluetooth_flaps = 0;
+
+static void bluetooth_settled(void *data) {
+	bluetooth_timer = NULL;
+	bluetooth_connected = bluetooth_pending;
+	bluetooth_changed();
+}
+
+static void bluetooth_connection_handler(bool connected) {
+	// A repeat of the state on its way, or of the one shown, changes nothing
+	if (connected == (bluetooth_timer ? bluetooth_pending : bluetooth_connected)) {
+		return;
+	}
+	bluetooth_pending = connected;
+	if (bluetooth_timer) {
+		// Back to the state shown before the change settled
+		bluetooth_flaps++;
+		app_timer_cancel(bluetooth_timer);
+		bluetooth_timer = NULL;
+	} else {
+		bluetooth_timer = app_timer_register(BLUETOOTH_SETTLE_MS, bluetooth_settled, NULL);
+	}
+}
+
+static void bluetooth_start(void) {
+	bluetooth_connected = bluetooth_connection_service_peek();
+	bluetooth_connection_service_subscribe(bluetooth_connection_handler);
+}
+
+static void bluetooth_stop(void) {
+	bluetooth_connection_service_unsubscribe();
+	if (bluetooth_timer) {
+		app_timer_cancel(bluetooth_timer);
+		bluetooth_timer = NULL;
+	}
+}
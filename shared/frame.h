@@ -0,0 +1,54 @@
+/*
+ * Frame scheduler. Handlers update the face's state, note what that changes
+ * on screen with frame_request(FRAME_* bits) and return. A single app_timer
+ * then hands everything noted since the last pass to the face's
+ * frame_apply(), which sets the texts and marks the layers dirty, so a tick
+ * and a battery or Bluetooth event that arrive together are drawn in one
+ * render pass rather than one each.
+ *
+ * frame_requests counts the handlers that asked for a frame and
+ * frame_passes the passes run, the difference is the passes saved.
+ */
+#pragma once
+
+// Queued behind the events already waiting, so the CPU is still awake for it
+#define FRAME_DEFER_MS 0
+
+typedef uint16_t FrameChanges;
+
+// The face's, applies the changes noted since the last pass
+static void frame_apply(FrameChanges changes);
+
+static AppTimer *frame_timer;
+static FrameChanges frame_changes;
+static uint32_t frame_requests = 0;
+static uint32_t frame_passes = 0;
+
+static void frame_run(void *data) {
+	FrameChanges changes = frame_changes;
+
+	frame_timer = NULL;
+	frame_changes = 0;
+	frame_passes++;
+	frame_apply(changes);
+}
+
+static void frame_request(FrameChanges changes) {
+	if (!changes) {
+		return;
+	}
+	frame_requests++;
+	frame_changes |= changes;
+	if (!frame_timer) {
+		frame_timer = app_timer_register(FRAME_DEFER_MS, frame_run, NULL);
+	}
+}
+
+// Drop what is pending, for when the layers it would touch go away
+static void frame_cancel(void) {
+	if (frame_timer) {
+		app_timer_cancel(frame_timer);
+		frame_timer = NULL;
+	}
+	frame_changes = 0;
+}
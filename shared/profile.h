@@ -0,0 +1,111 @@
+/*
+ * Hot path timing. With CONFIG_PROFILE defined, PROFILE_SCOPE(ring) at the
+ * top of a function records how long each call took, in ms, into a ring
+ * declared with PROFILE_RING(ring). PROFILE_START(ring) and
+ * PROFILE_STOP(ring) time a span that ends somewhere else, once per start.
+ * PROFILE_DUMP(ring) logs the ring's min/avg/p95/max and
+ * PROFILE_TRIPLE_TAP() is true on the third of three quick taps, to ask
+ * for a dump on the watch. Without CONFIG_PROFILE all of it compiles to
+ * nothing. The helpers are static inline, so a face that never stops a
+ * span still builds without warnings.
+ */
+#pragma once
+
+#ifdef CONFIG_PROFILE
+
+#define PROFILE_SAMPLES 	64
+#define PROFILE_TAP_MS 		1500
+
+typedef struct {
+	const char *name;
+	uint32_t start;	// of a PROFILE_START span, 0 when none
+	uint16_t ms[PROFILE_SAMPLES];
+	uint8_t next;
+	uint8_t count;
+} ProfileRing;
+
+typedef struct {
+	ProfileRing *ring;
+	uint32_t start;
+} ProfileScope;
+
+// Wraps every 49 days, only differences are used
+static inline uint32_t profile_now(void) {
+	time_t s;
+	uint16_t ms;
+
+	time_ms(&s, &ms);
+	return (uint32_t)s * 1000 + ms;
+}
+
+static inline void profile_add(ProfileRing *ring, uint32_t elapsed) {
+	ring->ms[ring->next] = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+	ring->next = (ring->next + 1) % PROFILE_SAMPLES;
+	if (ring->count < PROFILE_SAMPLES) {
+		ring->count++;
+	}
+}
+
+static inline void profile_scope_end(ProfileScope *scope) {
+	profile_add(scope->ring, profile_now() - scope->start);
+}
+
+static inline void profile_stop(ProfileRing *ring) {
+	if (ring->start) {
+		profile_add(ring, profile_now() - ring->start);
+		ring->start = 0;
+	}
+}
+
+static inline void profile_dump(const ProfileRing *ring) {
+	uint16_t sorted[PROFILE_SAMPLES];
+	uint32_t sum = 0;
+
+	if (!ring->count) {
+		APP_LOG(APP_LOG_LEVEL_INFO, "%s: no samples", ring->name);
+		return;
+	}
+	// Insertion sort, the ring is small and this only runs on request
+	for(int i = 0; i < ring->count; i++) {
+		uint16_t ms = ring->ms[i];
+		int j = i;
+
+		for(; j > 0 && sorted[j - 1] > ms; j--) {
+			sorted[j] = sorted[j - 1];
+		}
+		sorted[j] = ms;
+		sum += ms;
+	}
+	APP_LOG(APP_LOG_LEVEL_INFO, "%s: %d samples, min %d avg %d.%d p95 %d max %d ms", ring->name,
+		ring->count, sorted[0], (int)(sum / ring->count), (int)(sum * 10 / ring->count % 10),
+		sorted[(ring->count * 95 - 1) / 100], sorted[ring->count - 1]);
+}
+
+static inline bool profile_triple_tap(void) {
+	static uint32_t taps[2];	// the two taps before this one
+	uint32_t now = profile_now();
+	bool triple = taps[0] && now - taps[0] <= PROFILE_TAP_MS;
+
+	taps[0] = triple ? 0 : taps[1];
+	taps[1] = triple ? 0 : now;
+	return triple;
+}
+
+#define PROFILE_RING(ring) static ProfileRing profile_##ring = { .name = #ring }
+#define PROFILE_SCOPE(ring) ProfileScope profile_scope \
+	__attribute__((cleanup(profile_scope_end))) = { &profile_##ring, profile_now() }
+#define PROFILE_START(ring) (profile_##ring.start = profile_now())
+#define PROFILE_STOP(ring) profile_stop(&profile_##ring)
+#define PROFILE_DUMP(ring) profile_dump(&profile_##ring)
+#define PROFILE_TRIPLE_TAP() profile_triple_tap()
+
+#else
+
+#define PROFILE_RING(ring)
+#define PROFILE_SCOPE(ring) do {} while (0)
+#define PROFILE_START(ring) do {} while (0)
+#define PROFILE_STOP(ring) do {} while (0)
+#define PROFILE_DUMP(ring) do {} while (0)
+#define PROFILE_TRIPLE_TAP() false
+
+#endif
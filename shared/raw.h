@@ -0,0 +1,11 @@
+/*
+ * Raw frame buffer stores. A face that writes a captured frame buffer, or
+ * copies it, bypasses the drawing calls the host harness counts pixels in,
+ * so it reports what it stored with RAW_PIXELS(count) itself. The host SDK
+ * counts them with the drawn ones; on the watch it is nothing.
+ */
+#pragma once
+
+#ifndef RAW_PIXELS
+#define RAW_PIXELS(count) do {} while (0)
+#endif
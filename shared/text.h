@@ -0,0 +1,14 @@
+/*
+ * Text layer helpers.
+ */
+#pragma once
+
+// text_layer_set_text() marks the layer dirty even for the same text, so
+// keep the shown text in buffer and only hand over a different one
+static inline void set_text_if_changed(TextLayer *layer, char *buffer, size_t size, const char *text) {
+	if (strncmp(buffer, text, size) == 0) {
+		return;
+	}
+	snprintf(buffer, size, "%s", text);
+	text_layer_set_text(layer, buffer);
+}
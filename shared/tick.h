@@ -0,0 +1,71 @@
+/*
+ * Tick scheduling. Each element of a face updates at the finest time unit
+ * it shows; the face subscribes to the finest of them and a tick only runs
+ * the elements whose unit changed. An element returns what it changed on
+ * screen, and the tick asks for one frame pass with all of it, see frame.h.
+ *
+ * The face keeps its elements in a table indexed by its own enum and hands
+ * it over with TICK_START(table). An element whose unit is 0 is not shown
+ * and never runs.
+ */
+#pragma once
+
+#include "frame.h"
+#include "profile.h"
+
+typedef struct {
+	TimeUnits unit;			// 0 while the element is not shown
+	FrameChanges (*update)(struct tm *tick_time);
+} TickElement;
+
+// Timed with CONFIG_PROFILE, the face dumps it with its own rings
+PROFILE_RING(tick_handler);
+
+static TickElement *tick_elements;
+static unsigned int tick_element_count;
+static TimeUnits tick_units = 0;
+
+static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
+	FrameChanges changes = 0;
+
+	PROFILE_SCOPE(tick_handler);
+	for(unsigned int i = 0; i < tick_element_count; i++) {
+		if (units_changed & tick_elements[i].unit) {
+			changes |= tick_elements[i].update(tick_time);
+		}
+	}
+	frame_request(changes);
+}
+
+// Subscribe to the finest unit any element needs, if that changed
+static void tick_schedule(void) {
+	TimeUnits finest = 0;
+
+	for(unsigned int i = 0; i < tick_element_count; i++) {
+		if (tick_elements[i].unit && (!finest || tick_elements[i].unit < finest)) {
+			finest = tick_elements[i].unit;
+		}
+	}
+	if (finest != tick_units) {
+		tick_units = finest;
+		tick_timer_service_subscribe(tick_units, tick_handler);
+	}
+}
+
+static void tick_set_unit(int element, TimeUnits unit) {
+	tick_elements[element].unit = unit;
+	tick_schedule();
+}
+
+#define TICK_START(table) tick_start((table), ARRAY_LENGTH(table))
+
+static void tick_start(TickElement *elements, unsigned int count) {
+	tick_elements = elements;
+	tick_element_count = count;
+	tick_schedule();
+}
+
+static void tick_stop(void) {
+	tick_timer_service_unsubscribe();
+	tick_units = 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * Screen layout, chosen at compile time for the platform being built.
+ * tools/gen_hand_tables.py reads the integer defines of the block that
+ * applies to its platform, so the hand and dial tables match.
+ */
+#pragma once
+
+#if defined(PBL_ROUND)
+// chalk, 180x180 round
+#define LAYOUT_WIDTH 		180
+#define LAYOUT_HEIGHT 		180
+#define LAYOUT_CENTER_X 	90
+#define LAYOUT_CENTER_Y 	90
+#define HAND_LENGTH_SEC 	80
+#define HAND_LENGTH_SEC_TAIL 24
+#define HAND_LENGTH_MIN 	80
+#define HAND_LENGTH_HOUR 	55
+// Spokes run past the edge and the dial mask cuts them down to markers
+#define SPOKE_LENGTH 		120
+#define DIAL_RADIUS 		85
+#define LAYOUT_DAY_IN_MONTH GRect(118, 57, 44, 40)
+#define LAYOUT_DAY_IN_WEEK 	GRect(118, 82, 44, 40)
+#define LAYOUT_BATTERY 		GRect(118, 92, 44, 40)
+#else
+// aplite, basalt and diorite, 144x168
+#define LAYOUT_WIDTH 		144
+#define LAYOUT_HEIGHT 		168
+#define LAYOUT_CENTER_X 	72
+#define LAYOUT_CENTER_Y 	84
+#define HAND_LENGTH_SEC 	65
+#define HAND_LENGTH_SEC_TAIL 20
+#define HAND_LENGTH_MIN 	65
+#define HAND_LENGTH_HOUR 	45
+#define SPOKE_LENGTH 		195
+#define MARGIN 				5
+#define DIAL_RECT 			GRect(MARGIN, MARGIN, LAYOUT_WIDTH - 2 * MARGIN, LAYOUT_HEIGHT - 2 * MARGIN)
+#define LAYOUT_DAY_IN_MONTH GRect(90, 51, 44, 40)
+#define LAYOUT_DAY_IN_WEEK 	GRect(90, 76, 44, 40)
+#define LAYOUT_BATTERY 		GRect(90, 86, 44, 40)
+#endif
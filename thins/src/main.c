@@ -1,15 +1,36 @@
 #include <pebble.h>
+#include "layout.h"
+#include "src/hand_tables.auto.h"
 
-/*#define CONFIG_SHOW_SECOND*/
 #define CONFIG_SHOW_TEXT
+/*#define CONFIG_FAST_RASTER*/
+/*#define CONFIG_DAMAGE_TRACKING*/
+/*#define CONFIG_PROFILE*/
 
-// Layout
-#define MARGIN 				5
+// Round screens are never 1bpp, so there is nothing for the fast path to do
+#ifdef PBL_ROUND
+#undef CONFIG_FAST_RASTER
+#endif
+
+#include "profile.h"
+#include "frame.h"
+#include "tick.h"
+#include "bluetooth.h"
+#include "text.h"
+#include "raw.h"
+
+// Timed with CONFIG_PROFILE, a triple tap logs them
+PROFILE_RING(bg_update_proc);
+PROFILE_RING(draw_proc);
+
+// Layout, the per-platform part is in layout.h
 #define THICKNESS_MIN 		3
 #define THICKNESS_SEC 		1
-#define HAND_LENGTH_SEC 	65
-#define HAND_LENGTH_MIN 	65
-#define HAND_LENGTH_HOUR 	45
+#define THICKNESS_SEC_HAND 	2
+#define DAMAGE_MARGIN 		6
+
+// A wrist flick shows the second hand for this long
+#define SECOND_HAND_TIMEOUT_MS 	30000
 
 typedef struct {
 #ifdef CONFIG_SHOW_TEXT
@@ -18,168 +39,530 @@ typedef struct {
 #endif
 	int hours;
 	int minutes;
-#ifdef CONFIG_SHOW_SECOND
 	int seconds;
-#endif
 } Time;
 
 static Time s_time;
 static Window *s_main_window;
 static Layer *s_canvas_layer, *s_bg_layer;
+static GBitmap *s_dial_bitmap;
+static int s_dial_bucket = -1;
 #ifdef CONFIG_SHOW_TEXT
 static TextLayer *s_day_in_month_layer;
 static TextLayer *s_day_in_week_layer;
 static TextLayer *s_battery_layer;
 static char s_day_in_month_buffer[3];
+static char s_day_in_week_buffer[4];
 static char s_battery_buffer[3];
+static BatteryChargeState s_battery;
 static const char *s_day_in_week_string[] = {
     "Sun", "Mon", "Tue", "Wed", "Thr", "Fri", "Sat"
 };
 #endif
-static bool bluetoothConnected = false;
+static bool s_show_seconds = false;
+static AppTimer *s_seconds_timer;
 
-static void bg_update_proc(Layer *layer, GContext *ctx) {
-	GRect bounds = layer_get_bounds(layer);
-	GPoint center = grect_center_point(&bounds);
+// Tick elements, see tick.h
+enum { TICK_HANDS, TICK_DATE };
 
-	for(int h = 0; h < 12; h++) {
-		for(int y = 0; y < THICKNESS_MIN; y++) {
-			for(int x = 0; x < THICKNESS_MIN; x++) {
-				GPoint point = (GPoint) {
-					.x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * h / 12) * (int32_t)(3 * HAND_LENGTH_SEC) / TRIG_MAX_RATIO) + center.x,
-					.y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * h / 12) * (int32_t)(3 * HAND_LENGTH_SEC) / TRIG_MAX_RATIO) + center.y,
-				};
-
-				graphics_context_set_stroke_color(ctx, GColorWhite);
-				graphics_draw_line(ctx, GPoint(center.x + x, center.y + y), GPoint(point.x + x, point.y + y));
+// What a frame pass brings up to date, see frame.h and frame_apply()
+enum {
+	FRAME_HANDS = 1 << 0,	// the canvas: hands, seconds and Bluetooth
+	FRAME_DATE = 1 << 1,
+	FRAME_BATTERY = 1 << 2,
+};
+
+#ifdef CONFIG_DAMAGE_TRACKING
+/*
+ * Damage tracking: the window is not cleared, so the frame buffer still
+ * holds the last frame. When only the hands moved, the background layer
+ * draws nothing and draw_proc restores the rectangles the old hands
+ * covered from a snapshot of the frame as it was under the hands.
+ */
+#define HAND_DAMAGE_COUNT 3
+
+static GBitmap *s_under_hands;
+static GRect s_hand_damage[HAND_DAMAGE_COUNT];
+static bool s_full_redraw = true;
+#endif
+
+#ifdef CONFIG_FAST_RASTER
+/*
+ * Fast path: hands, markers and the dial mask are written straight into a
+ * captured 1bpp frame buffer, 32 pixels per store. Pixels are LSB first in
+ * each byte, so on the little-endian watch pixel x of a row is bit x % 32
+ * of word x / 32. Both layers are full screen, so layer coordinates are
+ * frame buffer coordinates.
+ */
+#define FAST_MAX_THICKNESS 8
+
+typedef struct {
+	GBitmap *bitmap;
+	uint8_t *data;
+	uint16_t bytes_per_row;
+	GSize size;
+} FastFrame;
+
+static FastFrame s_fast;
+
+// Capture the frame buffer if it is one we can write to directly
+static bool fast_begin(GContext *ctx) {
+	GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+	if (!fb) {
+		return false;
+	}
+	s_fast.data = gbitmap_get_data(fb);
+	s_fast.bytes_per_row = gbitmap_get_bytes_per_row(fb);
+	if (gbitmap_get_format(fb) != GBitmapFormat1Bit || s_fast.bytes_per_row % 4 || (uintptr_t)s_fast.data % 4) {
+		graphics_release_frame_buffer(ctx, fb);
+		return false;
+	}
+	s_fast.bitmap = fb;
+	s_fast.size = gbitmap_get_bounds(fb).size;
+	return true;
+}
+
+static void fast_end(GContext *ctx) {
+	if (s_fast.bitmap) {
+		graphics_release_frame_buffer(ctx, s_fast.bitmap);
+		s_fast.bitmap = NULL;
+	}
+}
+
+static void fast_fill_span(int y, int x0, int x1, bool white) {
+	if (y < 0 || y >= s_fast.size.h) {
+		return;
+	}
+	x0 = x0 < 0 ? 0 : x0;
+	x1 = x1 >= s_fast.size.w ? s_fast.size.w - 1 : x1;
+	if (x0 > x1) {
+		return;
+	}
+
+	uint32_t *row = (uint32_t *)(s_fast.data + y * s_fast.bytes_per_row);
+	int first = x0 >> 5, last = x1 >> 5;
+	uint32_t first_mask = ~0u << (x0 & 31);
+	uint32_t last_mask = ~0u >> (31 - (x1 & 31));
+
+	RAW_PIXELS(x1 - x0 + 1);
+	if (first == last) {
+		first_mask &= last_mask;
+	}
+	row[first] = white ? row[first] | first_mask : row[first] & ~first_mask;
+	if (first == last) {
+		return;
+	}
+	for(int w = first + 1; w < last; w++) {
+		row[w] = white ? ~0u : 0;
+	}
+	row[last] = white ? row[last] | last_mask : row[last] & ~last_mask;
+}
+
+static void fast_fill_rect(GRect rect, bool white) {
+	for(int y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+		fast_fill_span(y, rect.origin.x, rect.origin.x + rect.size.w - 1, white);
+	}
+}
+
+/*
+ * Sweeps a thickness x thickness square along the Bresenham line, one
+ * span per row. A row of the result is the union of the line's runs on
+ * the thickness rows above it, each widened by thickness - 1, so only
+ * that many pending rows are kept.
+ */
+static void fast_draw_thick_line(GPoint from, GPoint to, int thickness) {
+	int16_t lo[FAST_MAX_THICKNESS], hi[FAST_MAX_THICKNESS];
+	GPoint p0 = from.y <= to.y ? from : to;
+	GPoint p1 = from.y <= to.y ? to : from;
+	int dx = abs(p1.x - p0.x), sx = p0.x < p1.x ? 1 : -1;
+	int dy = -(p1.y - p0.y);
+	int err = dx + dy;
+	int x = p0.x, y = p0.y;
+	int run_y = y, run_lo = x, run_hi = x;
+
+	for(int i = 0; i < thickness; i++) {
+		lo[i] = INT16_MAX;
+		hi[i] = INT16_MIN;
+	}
+	for(;;) {
+		bool done = x == p1.x && y == p1.y;
+		int e2 = 2 * err;
+
+		if (!done) {
+			if (e2 >= dy) {
+				err += dy;
+				x += sx;
+			}
+			if (e2 <= dx) {
+				err += dx;
+				y++;
 			}
 		}
+		if (!done && y == run_y) {
+			run_lo = x < run_lo ? x : run_lo;
+			run_hi = x > run_hi ? x : run_hi;
+			continue;
+		}
+
+		// The run on row run_y is complete: widen the pending rows and flush run_y
+		for(int i = 0; i < thickness; i++) {
+			int slot = (run_y - p0.y + i) % thickness;
+			lo[slot] = run_lo < lo[slot] ? run_lo : lo[slot];
+			hi[slot] = run_hi + thickness - 1 > hi[slot] ? run_hi + thickness - 1 : hi[slot];
+		}
+		for(int i = 0; i < (done ? thickness : 1); i++) {
+			int slot = (run_y - p0.y + i) % thickness;
+			fast_fill_span(run_y + i, lo[slot], hi[slot], true);
+			lo[slot] = INT16_MAX;
+			hi[slot] = INT16_MIN;
+		}
+		if (done) {
+			break;
+		}
+		run_y = y;
+		run_lo = run_hi = x;
 	}
+}
+#endif
 
-	// Draw minute markers
-	for(int h = 0; h < 5; h++) {
-		for(int y = 0; y < THICKNESS_SEC; y++) {
-			for(int x = 0; x < THICKNESS_SEC; x++) {
-				GPoint point = (GPoint) {
-					.x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * (s_time.minutes / 5) / 12 + TRIG_MAX_ANGLE * h / 60) * \
-							(int32_t)(3 * HAND_LENGTH_SEC) / TRIG_MAX_RATIO) + center.x,
-					.y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * (s_time.minutes / 5) / 12 + TRIG_MAX_ANGLE * h / 60) * \
-							(int32_t)(3 * HAND_LENGTH_SEC) / TRIG_MAX_RATIO) + center.y,
-				};
-
-				graphics_context_set_stroke_color(ctx, GColorWhite);
-				graphics_draw_line(ctx, GPoint(center.x + x, center.y + y), GPoint(point.x + x, point.y + y));
+// One stroke covering the thickness x thickness square swept from "from" to "to".
+// The SDK only draws odd stroke widths, so an even square is swept with a
+// one pixel line per offset in it.
+static void draw_thick_line(GContext *ctx, GPoint from, GPoint to, int thickness) {
+	int offset = thickness / 2;
+
+#ifdef CONFIG_FAST_RASTER
+	if (s_fast.bitmap && thickness <= FAST_MAX_THICKNESS) {
+		fast_draw_thick_line(from, to, thickness);
+		return;
+	}
+#endif
+
+	if (thickness % 2 == 0) {
+		graphics_context_set_stroke_width(ctx, 1);
+		for(int y = 0; y < thickness; y++) {
+			for(int x = 0; x < thickness; x++) {
+				graphics_draw_line(ctx, GPoint(from.x + x, from.y + y), GPoint(to.x + x, to.y + y));
 			}
 		}
+		return;
 	}
+	graphics_context_set_stroke_width(ctx, thickness);
+	graphics_draw_line(ctx, GPoint(from.x + offset, from.y + offset), GPoint(to.x + offset, to.y + offset));
+}
 
-	// Make markers
+// Round screens mask the dial with a circle, so only damage tracking's clear needs it there
+#if !defined(PBL_ROUND) || defined(CONFIG_DAMAGE_TRACKING)
+static void fill_black_rect(GContext *ctx, GRect rect) {
+#ifdef CONFIG_FAST_RASTER
+	if (s_fast.bitmap) {
+		fast_fill_rect(rect, false);
+		return;
+	}
+#endif
 	graphics_context_set_fill_color(ctx, GColorBlack);
-	graphics_fill_rect(ctx, GRect(MARGIN, MARGIN, bounds.size.w - (2 * MARGIN), bounds.size.h - (2 * MARGIN)), 0, GCornerNone);
+	graphics_fill_rect(ctx, rect, 0, GCornerNone);
+}
+#endif
+
+// Copy the pixels of rect between two bitmaps laid out like the frame buffer.
+// Rows are copied whole bytes at a time, so on 1bpp up to 7 pixels either side come along.
+static void copy_rect(GBitmap *dst, GBitmap *src, GRect rect) {
+	int bits = gbitmap_get_format(src) == GBitmapFormat1Bit ? 1 : 8;
+	GRect bounds = gbitmap_get_bounds(src);
+	int y0 = rect.origin.y < 0 ? 0 : rect.origin.y;
+	int y1 = rect.origin.y + rect.size.h > bounds.size.h ? bounds.size.h : rect.origin.y + rect.size.h;
+	int x0 = rect.origin.x < 0 ? 0 : rect.origin.x;
+	int x1 = rect.origin.x + rect.size.w > bounds.size.w ? bounds.size.w : rect.origin.x + rect.size.w;
+	uint8_t *src_data = gbitmap_get_data(src);
+	uint8_t *dst_data = gbitmap_get_data(dst);
+	uint16_t src_row = gbitmap_get_bytes_per_row(src);
+	uint16_t dst_row = gbitmap_get_bytes_per_row(dst);
+
+	if (x0 >= x1) {
+		return;
+	}
+	x0 = x0 * bits / 8;
+	x1 = (x1 * bits + 7) / 8;
+	for(int y = y0; y < y1; y++) {
+		memcpy(dst_data + y * dst_row + x0, src_data + y * src_row + x0, x1 - x0);
+	}
+	RAW_PIXELS((y1 - y0) * (x1 - x0) * 8 / bits);
 }
 
-static GPoint make_hand_point(int quantity, int intervals, int len, GPoint center) {
-	return (GPoint) {
-		.x = (int16_t)(sin_lookup(TRIG_MAX_ANGLE * quantity / intervals) * (int32_t)len / TRIG_MAX_RATIO) + center.x,
-		.y = (int16_t)(-cos_lookup(TRIG_MAX_ANGLE * quantity / intervals) * (int32_t)len / TRIG_MAX_RATIO) + center.y,
-	};
+// Copy what has been drawn so far into *bitmap, creating it on first use
+static bool snapshot_frame(GContext *ctx, GBitmap **bitmap) {
+	GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+	if (!fb) {
+		return false;
+	}
+	// Rows of a round frame buffer differ in length, copy_rect can't copy them
+	if (gbitmap_get_format(fb) == GBitmapFormat8BitCircular) {
+		graphics_release_frame_buffer(ctx, fb);
+		return false;
+	}
+	if (!*bitmap) {
+		*bitmap = gbitmap_create_blank(gbitmap_get_bounds(fb).size, gbitmap_get_format(fb));
+	}
+	if (*bitmap) {
+		copy_rect(*bitmap, fb, gbitmap_get_bounds(fb));
+	}
+	graphics_release_frame_buffer(ctx, fb);
+	return *bitmap != NULL;
 }
 
-static void draw_proc(Layer *layer, GContext *ctx) {
+static void bg_update_proc(Layer *layer, GContext *ctx) {
+	PROFILE_SCOPE(bg_update_proc);
 	GRect bounds = layer_get_bounds(layer);
-	GPoint center = grect_center_point(&bounds);  
+	GPoint center = GPoint(LAYOUT_CENTER_X, LAYOUT_CENTER_Y);
 
-	// Plot hand ends
-#ifdef CONFIG_SHOW_SECOND
-	GPoint second_hand_long = make_hand_point(s_time.seconds, 60, HAND_LENGTH_SEC, center);
-	GPoint second_hand_short = make_hand_point(s_time.seconds, 60, -20, center);
+#ifdef CONFIG_DAMAGE_TRACKING
+	// Only the hands moved, draw_proc repairs the frame buffer itself
+	if (!s_full_redraw) {
+		return;
+	}
 #endif
-	GPoint minute_hand_long = make_hand_point(s_time.minutes, 60, HAND_LENGTH_MIN, center);
 
-	float minute_angle = TRIG_MAX_ANGLE * s_time.minutes / 60;
-	float hour_angle;
+	// The dial only changes with the 5 minute marker
+	if (s_dial_bitmap && s_dial_bucket == s_time.minutes / 5) {
+		graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+		graphics_draw_bitmap_in_rect(ctx, s_dial_bitmap, bounds);
+		return;
+	}
 
-	s_time.hours -= (s_time.hours > 12) ? 12 : 0;
-	hour_angle = TRIG_MAX_ANGLE * s_time.hours / 12;
-	hour_angle += (minute_angle / TRIG_MAX_ANGLE) * (TRIG_MAX_ANGLE / 12);
+#ifdef CONFIG_FAST_RASTER
+	fast_begin(ctx);
+#endif
+#ifdef CONFIG_DAMAGE_TRACKING
+	// Nothing clears the window for us
+	fill_black_rect(ctx, bounds);
+#endif
+	graphics_context_set_stroke_color(ctx, GColorWhite);
+	for(int h = 0; h < 12; h++) {
+		draw_thick_line(ctx, center, s_marker_tips[h * 5], THICKNESS_MIN);
+	}
 
-	// Hour is more accurate
-	GPoint hour_hand_long = (GPoint) {
-		.x = (int16_t)(sin_lookup(hour_angle) * (int32_t)HAND_LENGTH_HOUR / TRIG_MAX_RATIO) + center.x,
-		.y = (int16_t)(-cos_lookup(hour_angle) * (int32_t)HAND_LENGTH_HOUR / TRIG_MAX_RATIO) + center.y,
-	};
+	// Draw minute markers
+	for(int h = 0; h < 5; h++) {
+		draw_thick_line(ctx, center, s_marker_tips[(s_time.minutes / 5) * 5 + h], THICKNESS_SEC);
+	}
 
-	// Draw hands
-	graphics_context_set_stroke_color(ctx, GColorWhite);
+	// Make markers
+#ifdef PBL_ROUND
+	graphics_context_set_fill_color(ctx, GColorBlack);
+	graphics_fill_circle(ctx, center, DIAL_RADIUS);
+#else
+	fill_black_rect(ctx, DIAL_RECT);
+#endif
+#ifdef CONFIG_FAST_RASTER
+	fast_end(ctx);
+#endif
 
-	for(int y = 0; y < THICKNESS_MIN; y++) {
-		for(int x = 0; x < THICKNESS_MIN; x++) {
-			graphics_draw_line(ctx, GPoint(center.x + x, center.y + y), GPoint(minute_hand_long.x + x, minute_hand_long.y + y));
-			graphics_draw_line(ctx, GPoint(center.x + x, center.y + y), GPoint(hour_hand_long.x + x, hour_hand_long.y + y));
-		}
+	// The background layer is full screen, so the whole frame is the dial
+	if (snapshot_frame(ctx, &s_dial_bitmap)) {
+		s_dial_bucket = s_time.minutes / 5;
 	}
+}
+
+static GPoint hand_point(const HandTip *tips, int index) {
+	return GPoint(tips[index].x, tips[index].y);
+}
 
-	// Draw second hand
-#ifdef CONFIG_SHOW_SECOND
-	for(int y = 0; y < THICKNESS_MIN - 1; y++) {
-		for(int x = 0; x < THICKNESS_MIN - 1; x++) {
-			graphics_context_set_stroke_color(ctx, GColorWhite);
-			graphics_draw_line(ctx, GPoint(center.x + x, center.y + y), GPoint(second_hand_short.x + x, second_hand_short.y + y));
+#ifdef CONFIG_DAMAGE_TRACKING
+// Box around a hand, wide enough for its thickness and the center dot
+static GRect hand_rect(GPoint from, GPoint to) {
+	int x = (from.x < to.x ? from.x : to.x) - DAMAGE_MARGIN;
+	int y = (from.y < to.y ? from.y : to.y) - DAMAGE_MARGIN;
+
+	return GRect(x, y, abs(to.x - from.x) + 2 * DAMAGE_MARGIN + 1, abs(to.y - from.y) + 2 * DAMAGE_MARGIN + 1);
+}
 
-			// Draw second hand tip
-			graphics_context_set_stroke_color(ctx, GColorWhite);
-			graphics_draw_line(ctx, GPoint(second_hand_short.x + x, second_hand_short.y + y), GPoint(second_hand_long.x + x, second_hand_long.y + y));
+// Erase the hands drawn last frame and remember where the new ones go
+static void restore_under_hands(GContext *ctx, const GRect *damage) {
+	if (s_full_redraw) {
+		// Everything under the hands was just drawn, keep it for the next frames
+		s_full_redraw = !snapshot_frame(ctx, &s_under_hands);
+	} else {
+		GBitmap *fb = graphics_capture_frame_buffer(ctx);
+
+		if (fb) {
+			for(int i = 0; i < HAND_DAMAGE_COUNT; i++) {
+				copy_rect(fb, s_under_hands, s_hand_damage[i]);
+			}
+			graphics_release_frame_buffer(ctx, fb);
 		}
 	}
+	memcpy(s_hand_damage, damage, sizeof(s_hand_damage));
+}
+#endif
+
+static void draw_proc(Layer *layer, GContext *ctx) {
+	PROFILE_SCOPE(draw_proc);
+	GPoint center = GPoint(LAYOUT_CENTER_X, LAYOUT_CENTER_Y);
+
+	// Plot hand ends
+	GPoint second_hand_long = hand_point(s_second_tips, s_time.seconds);
+	GPoint second_hand_short = hand_point(s_second_tails, s_time.seconds);
+	GPoint minute_hand_long = hand_point(s_minute_tips, s_time.minutes);
+	GPoint hour_hand_long = hand_point(s_hour_tips, (s_time.hours % 12) * 60 + s_time.minutes);
+
+#ifdef CONFIG_DAMAGE_TRACKING
+	GRect damage[HAND_DAMAGE_COUNT] = {
+		hand_rect(center, minute_hand_long),
+		hand_rect(center, hour_hand_long),
+		s_show_seconds ? hand_rect(second_hand_short, second_hand_long) : GRectZero,
+	};
+	restore_under_hands(ctx, damage);
+#endif
+
+	// Draw hands
+#ifdef CONFIG_FAST_RASTER
+	fast_begin(ctx);
+#endif
+	graphics_context_set_stroke_color(ctx, GColorWhite);
+	draw_thick_line(ctx, center, minute_hand_long, THICKNESS_MIN);
+	draw_thick_line(ctx, center, hour_hand_long, THICKNESS_MIN);
+
+	// Draw second hand, tail to tip through the center
+	if (s_show_seconds) {
+		draw_thick_line(ctx, second_hand_short, second_hand_long, THICKNESS_SEC_HAND);
+	}
+#ifdef CONFIG_FAST_RASTER
+	fast_end(ctx);
 #endif
 
 	// Center
 	graphics_context_set_fill_color(ctx, GColorWhite);
 	graphics_fill_circle(ctx, GPoint(center.x + 1, center.y + 1), 4);
-	if (!bluetoothConnected) {
+	if (!bluetooth_connected) {
 		graphics_context_set_fill_color(ctx, GColorBlack);
 		graphics_fill_circle(ctx, GPoint(center.x + 1, center.y + 1), 2);
 	}
 }
 
-void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
 #ifdef CONFIG_SHOW_TEXT
-	s_time.mday = tick_time->tm_mday;
-	s_time.wday = tick_time->tm_wday;
+static void draw_date(void) {
+	char text[sizeof(s_day_in_month_buffer)];
+
+	snprintf(text, sizeof(text), "%02d", s_time.mday);
+	set_text_if_changed(s_day_in_month_layer, s_day_in_month_buffer, sizeof(s_day_in_month_buffer), text);
+	set_text_if_changed(s_day_in_week_layer, s_day_in_week_buffer, sizeof(s_day_in_week_buffer),
+		s_day_in_week_string[s_time.wday]);
+}
+
+static void draw_battery(BatteryChargeState charge) {
+	char text[sizeof(s_battery_buffer)];
+
+	if (charge.charge_percent == 100)
+		strcpy(text, "FU");
+	else
+		snprintf(text, sizeof(text), "%02d", charge.charge_percent % 100);
+	set_text_if_changed(s_battery_layer, s_battery_buffer, sizeof(s_battery_buffer), text);
+}
+#endif
+
+static FrameChanges tick_update_hands(struct tm *tick_time) {
+#ifdef CONFIG_DAMAGE_TRACKING
+	// The dial's 5 minute marker is part of the background
+	if (tick_time->tm_min / 5 != s_dial_bucket) {
+		s_full_redraw = true;
+	}
 #endif
 	s_time.hours = tick_time->tm_hour;
 	s_time.minutes = tick_time->tm_min;
-#ifdef CONFIG_SHOW_SECOND
 	s_time.seconds = tick_time->tm_sec;
-#endif
+	return FRAME_HANDS;
+}
 
 #ifdef CONFIG_SHOW_TEXT
-	snprintf(s_day_in_month_buffer, sizeof(s_day_in_month_buffer), "%02d", s_time.mday);
-	text_layer_set_text(s_day_in_month_layer, s_day_in_month_buffer);
+static FrameChanges tick_update_date(struct tm *tick_time) {
+#ifdef CONFIG_DAMAGE_TRACKING
+	// So is the date
+	if (tick_time->tm_mday != s_time.mday) {
+		s_full_redraw = true;
+	}
+#endif
+	s_time.mday = tick_time->tm_mday;
+	s_time.wday = tick_time->tm_wday;
+	return FRAME_DATE;
+}
+#endif
 
-	text_layer_set_text(s_day_in_week_layer, s_day_in_week_string[s_time.wday]);
+static TickElement s_tick_table[] = {
+	// Seconds while the second hand is shown
+	[TICK_HANDS] = { MINUTE_UNIT, tick_update_hands },
+#ifdef CONFIG_SHOW_TEXT
+	[TICK_DATE] = { DAY_UNIT, tick_update_date },
 #endif
+};
 
-	layer_mark_dirty(s_canvas_layer);
+// Burst over, back to one wakeup a minute
+static void seconds_timeout_handler(void *data) {
+	s_seconds_timer = NULL;
+	s_show_seconds = false;
+	tick_set_unit(TICK_HANDS, MINUTE_UNIT);
+	frame_request(FRAME_HANDS);
+}
+
+// A flick shows the second hand, another one while it is shown extends it
+static void accel_tap_handler(AccelAxisType axis, int32_t direction) {
+	if (PROFILE_TRIPLE_TAP()) {
+		PROFILE_DUMP(bg_update_proc);
+		PROFILE_DUMP(draw_proc);
+		PROFILE_DUMP(tick_handler);
+	}
+	if (s_show_seconds) {
+		app_timer_reschedule(s_seconds_timer, SECOND_HAND_TIMEOUT_MS);
+		return;
+	}
+
+	time_t t = time(NULL);
+	s_time.seconds = localtime(&t)->tm_sec;
+	s_show_seconds = true;
+	s_seconds_timer = app_timer_register(SECOND_HAND_TIMEOUT_MS, seconds_timeout_handler, NULL);
+	tick_set_unit(TICK_HANDS, SECOND_UNIT);
+	frame_request(FRAME_HANDS);
 }
 
 #ifdef CONFIG_SHOW_TEXT
 void battery_state_handler(BatteryChargeState charge) {
-	if (charge.charge_percent == 100)
-		strcpy(s_battery_buffer, "FU");
-	else
-		snprintf(s_battery_buffer, sizeof(s_battery_buffer), "%02d", charge.charge_percent);
-	text_layer_set_text(s_battery_layer, s_battery_buffer);
+	// Plug edges and repeated levels leave the percentage as it is
+	if (charge.charge_percent == s_battery.charge_percent) {
+		return;
+	}
+	s_battery = charge;
+#ifdef CONFIG_DAMAGE_TRACKING
+	// The text is under the snapshot of what the hands cover
+	s_full_redraw = true;
+#endif
+	frame_request(FRAME_BATTERY);
 }
 #endif
 
-void bluetooth_connection_handler(bool connected) {
-    bluetoothConnected = connected;
-	if (!bluetoothConnected) {
+// A disconnect that held vibrates, see bluetooth.h
+static void bluetooth_changed(void) {
+	if (!bluetooth_connected) {
 		vibes_cancel();
 		vibes_short_pulse();
 	}
-	layer_mark_dirty(s_canvas_layer);
+	frame_request(FRAME_HANDS);
+}
+
+// One render pass for everything the handlers noted since the last
+static void frame_apply(FrameChanges changes) {
+#ifdef CONFIG_SHOW_TEXT
+	if (changes & FRAME_DATE) {
+		draw_date();
+	}
+	if (changes & FRAME_BATTERY) {
+		draw_battery(s_battery);
+	}
+#endif
+	if (changes & FRAME_HANDS) {
+		layer_mark_dirty(s_canvas_layer);
+	}
 }
 
 static void main_window_load(Window *window)
@@ -192,21 +575,21 @@ static void main_window_load(Window *window)
 	layer_add_child(window_layer, s_bg_layer);
 
 #ifdef CONFIG_SHOW_TEXT
-	s_day_in_month_layer = text_layer_create(GRect(90, 51, 44, 40));
+	s_day_in_month_layer = text_layer_create(LAYOUT_DAY_IN_MONTH);
 	text_layer_set_text_alignment(s_day_in_month_layer, GTextAlignmentCenter);
 	text_layer_set_font(s_day_in_month_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24));
 	text_layer_set_text_color(s_day_in_month_layer, GColorWhite);
 	text_layer_set_background_color(s_day_in_month_layer, GColorClear);
 	layer_add_child(window_layer, text_layer_get_layer(s_day_in_month_layer));
 
-	s_day_in_week_layer = text_layer_create(GRect(90, 76, 44, 40));
+	s_day_in_week_layer = text_layer_create(LAYOUT_DAY_IN_WEEK);
 	text_layer_set_text_alignment(s_day_in_week_layer, GTextAlignmentCenter);
 	text_layer_set_font(s_day_in_week_layer, fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD));
 	text_layer_set_text_color(s_day_in_week_layer, GColorWhite);
 	text_layer_set_background_color(s_day_in_week_layer,  GColorClear);
 	layer_add_child(window_layer, text_layer_get_layer(s_day_in_week_layer));
 
-	s_battery_layer = text_layer_create(GRect(90, 86, 44, 40));
+	s_battery_layer = text_layer_create(LAYOUT_BATTERY);
 	text_layer_set_text_alignment(s_battery_layer, GTextAlignmentCenter);
 	text_layer_set_font(s_battery_layer, fonts_get_system_font(FONT_KEY_GOTHIC_24));
 	text_layer_set_text_color(s_battery_layer, GColorWhite);
@@ -219,21 +602,14 @@ static void main_window_load(Window *window)
 	layer_add_child(window_layer, s_canvas_layer);
 
 #ifdef CONFIG_SHOW_TEXT
-	snprintf(s_day_in_month_buffer, sizeof(s_day_in_month_buffer), "%02d", s_time.mday);
-	text_layer_set_text(s_day_in_month_layer, s_day_in_month_buffer);
-
-	text_layer_set_text(s_day_in_week_layer, s_day_in_week_string[s_time.wday]);
-
-    BatteryChargeState initial = battery_state_service_peek();
-	if (initial.charge_percent == 100)
-		strcpy(s_battery_buffer, "FU");
-	else
-		snprintf(s_battery_buffer, sizeof(s_battery_buffer), "%02d", initial.charge_percent);
-	text_layer_set_text(s_battery_layer, s_battery_buffer);
+	draw_date();
+	s_battery = battery_state_service_peek();
+	draw_battery(s_battery);
 #endif
 }
 
 static void main_window_unload(Window *window) {
+	frame_cancel();
 #ifdef CONFIG_SHOW_TEXT
 	text_layer_destroy(s_battery_layer);
 	text_layer_destroy(s_day_in_month_layer);
@@ -242,16 +618,29 @@ static void main_window_unload(Window *window) {
 
 	layer_destroy(s_canvas_layer);
 	layer_destroy(s_bg_layer);
+	gbitmap_destroy(s_dial_bitmap);
+	s_dial_bitmap = NULL;
+	s_dial_bucket = -1;
+#ifdef CONFIG_DAMAGE_TRACKING
+	gbitmap_destroy(s_under_hands);
+	s_under_hands = NULL;
+	s_full_redraw = true;
+#endif
 }
 
+#ifdef CONFIG_DAMAGE_TRACKING
+// Whatever covered the window may have drawn over the last frame
+static void main_window_appear(Window *window) {
+	s_full_redraw = true;
+}
+#endif
+
 static void init() {
 	time_t t = time(NULL);
 	struct tm *tm_now = localtime(&t);
 	s_time.hours = tm_now->tm_hour;
 	s_time.minutes = tm_now->tm_min;
-#ifdef CONFIG_SHOW_SECOND
-	s_time.seconds = tm_now->tm_sec;  
-#endif
+	s_time.seconds = tm_now->tm_sec;
 #ifdef CONFIG_SHOW_TEXT
 	s_time.mday = tm_now->tm_mday;
 	s_time.wday = tm_now->tm_wday;
@@ -261,30 +650,38 @@ static void init() {
 	s_main_window = window_create();
 	window_set_window_handlers(s_main_window, (WindowHandlers) {
 		.load = main_window_load,
+#ifdef CONFIG_DAMAGE_TRACKING
+		.appear = main_window_appear,
+#endif
 		.unload = main_window_unload
 	});
 	window_stack_push(s_main_window, true /* Animated */);
-	window_set_background_color(s_main_window, GColorBlack);
-
-#ifdef CONFIG_SHOW_SECOND
-	tick_timer_service_subscribe(SECOND_UNIT, tick_handler);
+#ifdef CONFIG_DAMAGE_TRACKING
+	window_set_background_color(s_main_window, GColorClear);
 #else
-	tick_timer_service_subscribe(MINUTE_UNIT, tick_handler);
+	window_set_background_color(s_main_window, GColorBlack);
 #endif
+
+	TICK_START(s_tick_table);
+	accel_tap_service_subscribe(accel_tap_handler);
 #ifdef CONFIG_SHOW_TEXT
 	battery_state_service_subscribe(&battery_state_handler);
 #endif
-	bluetooth_connection_service_subscribe(&bluetooth_connection_handler);
-    bluetoothConnected = bluetooth_connection_service_peek();
+	bluetooth_start();
 }
 
 /*
  * deinit
  */
 static void deinit() {
-	bluetooth_connection_service_unsubscribe();
+	if (s_seconds_timer) {
+		app_timer_cancel(s_seconds_timer);
+		s_seconds_timer = NULL;
+	}
+	accel_tap_service_unsubscribe();
+	bluetooth_stop();
 	battery_state_service_unsubscribe();
-    tick_timer_service_unsubscribe();
+    tick_stop();
     window_destroy(s_main_window);
 }
 
@@ -295,4 +692,5 @@ int main(void) {
     init();
     app_event_loop();
     deinit();
+    return 0;
 }
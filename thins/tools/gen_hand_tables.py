@@ -0,0 +1,151 @@
+#!/usr/bin/env python
+"""
+Generate the hand and dial endpoint tables for thins.
+
+    gen_hand_tables.py <platform> <path/to/layout.h> > hand_tables.auto.h
+
+Hand lengths, spoke length and the dial center are read from the block of
+layout.h that the platform's PBL_* defines select, so the watch only has
+to index a table instead of calling sin_lookup/cos_lookup for every frame. Angles use
+the same TRIG_MAX_ANGLE fixed-point integer math as the watch would, so no
+table entry depends on float rounding.
+
+The tables are about 2 KB of const data on aplite. It is loaded with the
+code, into the same 24 KB of app memory as the heap.
+"""
+
+import math
+import re
+import sys
+
+TRIG_MAX_RATIO = 0xffff
+TRIG_MAX_ANGLE = 0x10000
+
+SCREENS = {
+    'aplite': (144, 168),
+    'basalt': (144, 168),
+    'diorite': (144, 168),
+    'emery': (200, 228),
+    'chalk': (180, 180),
+}
+
+# What pebble.h defines on each platform
+PLATFORM_DEFINES = {
+    'aplite': {'PBL_PLATFORM_APLITE', 'PBL_BW', 'PBL_RECT'},
+    'basalt': {'PBL_PLATFORM_BASALT', 'PBL_COLOR', 'PBL_RECT'},
+    'diorite': {'PBL_PLATFORM_DIORITE', 'PBL_BW', 'PBL_RECT'},
+    'emery': {'PBL_PLATFORM_EMERY', 'PBL_COLOR', 'PBL_RECT'},
+    'chalk': {'PBL_PLATFORM_CHALK', 'PBL_COLOR', 'PBL_ROUND'},
+}
+
+
+def cdiv(a, b):
+    """C integer division, truncating towards zero."""
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def sin_lookup(angle):
+    angle &= TRIG_MAX_ANGLE - 1
+    value = math.sin(2 * math.pi * angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO
+    return int(math.copysign(math.floor(abs(value) + 0.5), value))
+
+
+def cos_lookup(angle):
+    return sin_lookup(angle + TRIG_MAX_ANGLE // 4)
+
+
+def point(angle, length, center):
+    return (cdiv(sin_lookup(angle) * length, TRIG_MAX_RATIO) + center[0],
+            cdiv(-cos_lookup(angle) * length, TRIG_MAX_RATIO) + center[1])
+
+
+def hour_angle(hours, minutes):
+    return cdiv(TRIG_MAX_ANGLE * (hours * 60 + minutes), 12 * 60)
+
+
+def condition(expr, defines):
+    """Evaluate an #if/#elif expression made of defined(), !, && and ||."""
+    expr = re.sub(r'defined\s*\(?\s*(\w+)\s*\)?',
+                  lambda m: str(m.group(1) in defines), expr)
+    expr = expr.replace('&&', ' and ').replace('||', ' or ')
+    return eval(re.sub(r'!(?!=)', ' not ', expr), {'__builtins__': {}})
+
+
+def read_defines(path, platform):
+    """Integer defines of the blocks of an #if chain that apply to platform."""
+    defines = PLATFORM_DEFINES[platform]
+    values = {}
+    # One entry per open #if: [this branch applies, an earlier branch did]
+    stack = []
+    with open(path) as f:
+        for line in f:
+            directive = re.match(r'\s*#\s*(ifdef|ifndef|if|elif|else|endif)\b(.*)', line)
+            if directive:
+                kind, rest = directive.group(1), directive.group(2).split('//')[0].strip()
+                if kind in ('if', 'ifdef', 'ifndef'):
+                    taken = (condition(rest, defines) if kind == 'if' else
+                             (rest in defines) == (kind == 'ifdef'))
+                    stack.append([taken, taken])
+                elif kind == 'elif':
+                    stack[-1][0] = not stack[-1][1] and condition(rest, defines)
+                    stack[-1][1] |= stack[-1][0]
+                elif kind == 'else':
+                    stack[-1][0] = not stack[-1][1]
+                else:
+                    stack.pop()
+                continue
+            if all(taken for taken, _ in stack):
+                define = re.match(r'\s*#define\s+(\w+)\s+(-?\d+)\b', line)
+                if define:
+                    values[define.group(1)] = int(define.group(2))
+    return values
+
+
+def emit(name, kind, points, comment):
+    lines = ['// ' + comment, 'static const %s %s[%d] = {' % (kind, name, len(points))]
+    for i in range(0, len(points), 6):
+        lines.append('\t' + ' '.join('{ %d, %d },' % p for p in points[i:i + 6]))
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def main(platform, layout_h):
+    layout = read_defines(layout_h, platform)
+    assert (layout['LAYOUT_WIDTH'], layout['LAYOUT_HEIGHT']) == SCREENS[platform], \
+        'layout.h has no layout for the %dx%d screen of %s' % (SCREENS[platform] + (platform,))
+    center = (layout['LAYOUT_CENTER_X'], layout['LAYOUT_CENTER_Y'])
+    sec, tail = layout['HAND_LENGTH_SEC'], layout['HAND_LENGTH_SEC_TAIL']
+    minute, hour = layout['HAND_LENGTH_MIN'], layout['HAND_LENGTH_HOUR']
+    spoke = layout['SPOKE_LENGTH']
+
+    tables = [
+        emit('s_minute_tips', 'HandTip',
+             [point(cdiv(TRIG_MAX_ANGLE * m, 60), minute, center) for m in range(60)],
+             'Minute hand tip for each minute'),
+        emit('s_hour_tips', 'HandTip',
+             [point(hour_angle(h, m), hour, center) for h in range(12) for m in range(60)],
+             'Hour hand tip for each minute of a 12 hour dial'),
+        emit('s_second_tips', 'HandTip',
+             [point(cdiv(TRIG_MAX_ANGLE * s, 60), sec, center) for s in range(60)],
+             'Second hand tip for each second'),
+        emit('s_second_tails', 'HandTip',
+             [point(cdiv(TRIG_MAX_ANGLE * s, 60), -tail, center) for s in range(60)],
+             'Second hand tail for each second'),
+        emit('s_marker_tips', 'GPoint',
+             [point(cdiv(TRIG_MAX_ANGLE * b, 12) + cdiv(TRIG_MAX_ANGLE * m, 60), spoke, center)
+              for b in range(12) for m in range(5)],
+             'Dial marker ends, five per 5 minute bucket; the first of each is the hour spoke'),
+    ]
+    for table in tables[:4]:
+        for x, y in re.findall(r'\{ (-?\d+), (-?\d+) \}', table):
+            assert 0 <= int(x) <= 255 and 0 <= int(y) <= 255, 'hand tip does not fit HandTip'
+
+    print('// Generated by tools/gen_hand_tables.py for %s, do not edit' % platform)
+    print('#pragma once\n')
+    print('typedef struct {\n\tuint8_t x;\n\tuint8_t y;\n} HandTip;\n')
+    print('\n\n'.join(tables))
+
+
+if __name__ == '__main__':
+    main(sys.argv[1], sys.argv[2])